@@ -140,6 +140,7 @@ void App::buildWingModel(Wing& w, bool inDraftMode) {
       if (!w.lets.create(w.plnf, w.aifs, log))
          break;
    } while (false);
+   DBGLVL1("Airfoil cache: %zu hits, %zu misses", w.aifs.cache_hits(), w.aifs.cache_misses());
 
    if (log.length() != 0) {
       dbg::alert(SS("There are issues with your model; it has not been completely built"), log);
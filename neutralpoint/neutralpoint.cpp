@@ -55,15 +55,21 @@ void neutralPoint(FILE** rfp) {
 
    // Calculate the slices
    {
+      // Find the top and bottom of the outline at every slice in one sweep
+      std::vector<double> xs(N_SLICE);
+      std::vector<obj_vert_intersect> tb;
+      for (size_t cnt = 0; cnt < N_SLICE; cnt++)
+         xs[cnt] = leftx + (xstep * (double)cnt);
+      dwg.top_bot_intersect(xs, tb);
+
       // Work through the slices in sequence
       for (size_t cnt = 0; cnt < N_SLICE; cnt++) {
-         slices[cnt].x = leftx + (xstep * (double)cnt);
+         slices[cnt].x = xs[cnt];
 
-         // Find the top and bottom of the outline at this x value and work out the area
-         coord_t upper, lower;
-         if (dwg.top_bot_intersect(slices[cnt].x, &upper, &lower)) {
-            slices[cnt].ymax = upper.y;
-            slices[cnt].ymin = lower.y;
+         // Work out the area from the top and bottom of the outline at this x value
+         if (tb[cnt].found) {
+            slices[cnt].ymax = tb[cnt].upper.y;
+            slices[cnt].ymin = tb[cnt].lower.y;
             slices[cnt].area = (slices[cnt].ymax - slices[cnt].ymin) * xstep;
          }
          else {
@@ -0,0 +1,162 @@
+/*
+Copyright(C) 2019-2025 Adrian Mansell
+
+This program is free software : you can redistribute it and /or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+
+// Standalone check of the exact predicates: orient2d() must give the same sign as exact arithmetic on near-degenerate
+// and collinear triples, and line::lines_intersect() must find short segments crossing at a shallow angle.
+// Returns 0 if every case passes.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+
+#include "object_oo.h"
+
+// Fixed width two's complement integer, wide enough to hold the sum of the six products of the determinant exactly
+// for coordinates whose magnitudes lie in [2^-40, 2^40]
+class wide_int {
+public:
+   static constexpr int LIMBS = 32;
+   uint32_t w[LIMBS] = {};
+
+   // Add m.2^shift with the given sign
+   void add(uint64_t m, int shift, bool neg) {
+      wide_int t;
+      int limb = shift / 32;
+      int bit = shift % 32;
+      uint64_t part[3] = { (m & 0xffffffffu) << bit, ((m >> 32) << bit), 0 };
+      part[2] = part[1] >> 32;
+      part[1] = (part[1] & 0xffffffffu) + (part[0] >> 32);
+      part[0] &= 0xffffffffu;
+      for (int k = 0; (k < 3) && ((k + limb) < LIMBS); k++) {
+         uint64_t s = (uint64_t)t.w[k + limb] + part[k];
+         t.w[k + limb] = (uint32_t)s;
+         if ((s >> 32) && ((k + 1) < 3))
+            part[k + 1] += s >> 32;
+      }
+      if (neg)
+         t.negate();
+      uint64_t carry = 0;
+      for (int k = 0; k < LIMBS; k++) {
+         uint64_t s = (uint64_t)w[k] + t.w[k] + carry;
+         w[k] = (uint32_t)s;
+         carry = s >> 32;
+      }
+   }
+
+   int sign() const {
+      if (w[LIMBS - 1] & 0x80000000u)
+         return -1;
+      for (uint32_t v : w)
+         if (v)
+            return 1;
+      return 0;
+   }
+
+private:
+   void negate() {
+      uint64_t carry = 1;
+      for (uint32_t& v : w) {
+         uint64_t s = (uint64_t)(uint32_t)~v + carry;
+         v = (uint32_t)s;
+         carry = s >> 32;
+      }
+   }
+};
+
+static constexpr int EXP_BIAS = 200; //!< Lifts the smallest product exponent above zero
+
+// Sign of the exact determinant, from the same six product expansion that orient2d() uses
+static int exactSign(coord_t a, coord_t b, coord_t c) {
+   const double f[6][2] = { { a.x, b.y }, { -a.x, c.y }, { -c.x, b.y }, { -a.y, b.x }, { a.y, c.x }, { c.y, b.x } };
+   wide_int acc;
+   for (const auto& pr : f) {
+      if ((pr[0] == 0.0) || (pr[1] == 0.0))
+         continue;
+      int e0, e1;
+      double m0 = std::frexp(std::fabs(pr[0]), &e0);
+      double m1 = std::frexp(std::fabs(pr[1]), &e1);
+      uint64_t i0 = (uint64_t)std::ldexp(m0, 53);
+      uint64_t i1 = (uint64_t)std::ldexp(m1, 53);
+      int shift = e0 + e1 - 106 + EXP_BIAS;
+      bool neg = (pr[0] < 0.0) != (pr[1] < 0.0);
+
+      // Split the 53 bit mantissas so that each partial product fits 64 bits
+      uint64_t h0 = i0 >> 32, l0 = i0 & 0xffffffffu;
+      uint64_t h1 = i1 >> 32, l1 = i1 & 0xffffffffu;
+      acc.add(l0 * l1, shift, neg);
+      acc.add(h0 * l1, shift + 32, neg);
+      acc.add(l0 * h1, shift + 32, neg);
+      acc.add(h0 * h1, shift + 64, neg);
+   }
+   return acc.sign();
+}
+
+static int signOf(double v) {
+   return (v > 0.0) - (v < 0.0);
+}
+
+static int failures = 0;
+static int cases = 0;
+
+static void checkTriple(coord_t a, coord_t b, coord_t c) {
+   cases++;
+   int got = signOf(orient2d(a, b, c));
+   int want = exactSign(a, b, c);
+   if (got != want) {
+      failures++;
+      printf("orient2d sign %d, exact %d: (%.17g, %.17g) (%.17g, %.17g) (%.17g, %.17g)\n", got, want, a.x, a.y, b.x, b.y,
+         c.x, c.y);
+   }
+}
+
+int main() {
+   // Shewchuk's grid: points a few ulps from the line through (12, 12) and (24, 24)
+   const double ulp = std::ldexp(1.0, -53);
+   for (int i = 0; i < 48; i++)
+      for (int j = 0; j < 48; j++)
+         checkTriple(coord_t{ 0.5 + (i * ulp), 0.5 + (j * ulp) }, coord_t{ 12.0, 12.0 }, coord_t{ 24.0, 24.0 });
+
+   // Points on random lines at model scale, nudged by at most a few ulps, and exactly collinear axis-aligned triples
+   std::mt19937_64 rng(20250101);
+   std::uniform_real_distribution<double> pos(-500.0, 500.0);
+   std::uniform_real_distribution<double> ratio(-2.0, 3.0);
+   std::uniform_int_distribution<int> nudge(-3, 3);
+   for (int n = 0; n < 2000; n++) {
+      coord_t a{ pos(rng), pos(rng) };
+      coord_t b{ pos(rng), pos(rng) };
+      double T = ratio(rng);
+      coord_t c{ a.x + (T * (b.x - a.x)), a.y + (T * (b.y - a.y)) };
+      for (int k = nudge(rng); k != 0; k += (k > 0) ? -1 : 1)
+         c.x = std::nextafter(c.x, (k > 0) ? HUGE_VAL : -HUGE_VAL);
+      checkTriple(a, b, c);
+      checkTriple(coord_t{ a.x, a.y }, coord_t{ b.x, a.y }, coord_t{ c.x, a.y });
+   }
+
+   // Two 1e-4 mm segments crossing at a shallow angle, inside the old parallel limit
+   cases++;
+   line l1(coord_t{ 0.0, 0.0 }, coord_t{ 1e-4, 0.0 });
+   line l2(coord_t{ 0.0, -1e-9 }, coord_t{ 1e-4, 1e-9 });
+   coord_t at;
+   if (!l1.lines_intersect(l2, &at, 0) || (std::fabs(at.x - 5e-5) > 1e-12) || (at.y != 0.0)) {
+      failures++;
+      printf("Shallow crossing not found at (5e-5, 0), got (%.17g, %.17g)\n", at.x, at.y);
+   }
+
+   printf("%d cases, %d failures\n", cases, failures);
+   return failures ? 1 : 0;
+}
@@ -107,8 +107,9 @@ void asciivec::add(obj& obj, const char* str) {
             if ((mask >> bt) & 1) {
                size_t pt0 = seg[bt][0];
                size_t pt1 = seg[bt][1];
-               obj.add(rp[pt0], rp[pt1]);
-               obj.last()->add_offset(next_c.x, next_c.y);
+               line ln(rp[pt0], rp[pt1]);
+               ln.add_offset(next_c.x, next_c.y);
+               obj.add(ln);
                //PR_ANY("%.1lf %.1lf  %.1lf %.1lf\n", obj.last()->get_S0().x, obj.last()->get_S0().y, obj.last()->get_S1().x, obj.last()->get_S1().y);
             }
          }
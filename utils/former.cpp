@@ -18,6 +18,7 @@ along with this program.If not, see < https://www.gnu.org/licenses/>.
 
 #include <QCoreApplication>
 
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <list>
@@ -64,7 +65,7 @@ bool LiteEngine::run(obj& in,
       out.copy_from(inp);
       return false;
    }
-   DBGLVL2("Object sp at %s", inp.get_sp().prstr());
+   DBGLVL2("Object sp at %s", coordStr(inp.get_sp()).c_str());
 
    // Create a version without notches
    createOuterRimOuter(notchDetect);
@@ -199,7 +200,7 @@ int LiteEngine::removeNotches(obj& o) {
          for (auto& nl : n->notchLines) {
             l = o.nextc(nl);
             if (first) {
-               nl->set(n->beg, n->end); // Replace the first line element with the joining line
+               o.set(nl, n->beg, n->end); // Replace the first line element with the joining line
                n->notchReplacedLineIter = nl;
                n->notchReplacedLine = *nl;
                first = false;
@@ -305,24 +306,26 @@ bool LiteEngine::generateAnchorPoints(bool anchorAtNotches) {
          // For each pair, find the distance around the reference between them
          // and work out how many anchor points there should be and their separation.
          nAnchors = 0;
+         const double nonLen = non.len();
+         std::vector<coord_t> pts;
+         std::vector<line_iter> lns;
          for (auto nc = notches.begin(); nc != notches.end(); ++nc) {
             auto nn = std::next(nc);
             if (nn == notches.end())
                nn = notches.begin();
-            double distBetween = (nc == nn) ? non.len() : nn->distance - nc->distance;
-            distBetween = (distBetween < 0.0) ? distBetween + non.len() : distBetween;
+            double distBetween = (nc == nn) ? nonLen : nn->distance - nc->distance;
+            distBetween = (distBetween < 0.0) ? distBetween + nonLen : distBetween;
             int nAnchorsBetween = (int)round(distBetween / as);
             double dAnchor = distBetween / nAnchorsBetween;
             // Layout the anchor points
+            non.get_pts_along_length(nc->distance, dAnchor, nAnchorsBetween, pts, &lns);
             for (int k = 0; k < nAnchorsBetween; ++k) {
                double d = nc->distance + (k * dAnchor);
-               double dummyT;
-               line_iter dummyLi;
                anchors.emplace_back();
-               anchors[nAnchors].rimPt = non.get_pt_along_length(d, dummyLi, dummyT);
-               anchors[nAnchors].rimLine = *dummyLi;
+               anchors[nAnchors].rimPt = pts[k];
+               anchors[nAnchors].rimLine = *lns[k];
                DBGLVL2("Notch %lld: Anchor %d: distance %.1lf  pt %s  line %s",
-                  std::distance(notches.begin(), nc), nAnchors, d, anchors[nAnchors].rimPt.prstr(), anchors[nAnchors].rimLine.print_str());
+                  std::distance(notches.begin(), nc), nAnchors, d, coordStr(anchors[nAnchors].rimPt).c_str(), anchors[nAnchors].rimLine.print_str());
                nAnchors++;
             }
          }
@@ -339,13 +342,14 @@ bool LiteEngine::generateAnchorPoints(bool anchorAtNotches) {
          anchors.emplace_back();
 
       // Find the point and line element each anchor on the outer reference
+      std::vector<coord_t> pts;
+      std::vector<line_iter> lns;
+      refori.get_pts_along_length(0.0, dAnchor, nAnchors, pts, &lns);
       for (int k = 0; k < nAnchors; ++k) {
          double cDist = k * dAnchor;
-         double dummyT;
-         line_iter dummyLi;
-         anchors[k].rimPt = refori.get_pt_along_length(cDist, dummyLi, dummyT);
-         anchors[k].rimLine = *dummyLi;
-         DBGLVL2("Anchor %d: distance %.1lf  pt %s  line %s", k, cDist, anchors[k].rimPt.prstr(), anchors[k].rimLine.print_str());
+         anchors[k].rimPt = pts[k];
+         anchors[k].rimLine = *lns[k];
+         DBGLVL2("Anchor %d: distance %.1lf  pt %s  line %s", k, cDist, coordStr(anchors[k].rimPt).c_str(), anchors[k].rimLine.print_str());
       }
    }
 
@@ -384,7 +388,7 @@ bool LiteEngine::generateAnchorPoints(bool anchorAtNotches) {
       // Find the intersections between cRef and the inner rim outer.
       // If there is no intersection, progressively rotate the reference
       // in each direction and try again.
-      std::list<obj_line_intersect> isects;
+      std::pmr::list<obj_line_intersect> isects;
       line cRef;
       bool done = false;
       for (int offsetAngle = 0; !done; ++offsetAngle) {
@@ -425,7 +429,7 @@ bool LiteEngine::generateAnchorPoints(bool anchorAtNotches) {
          }
          construct.add_dotted(a0.brace[1].refLn, 0.2, 1.2);
          construct.add_dotted(a1.brace[0].refLn, 0.2, 1.2);
-         DBGLVL2("Anchor %d: iro intersect at %s", k, isects.begin()->pt.prstr());
+         DBGLVL2("Anchor %d: iro intersect at %s", k, coordStr(isects.begin()->pt).c_str());
       }
    }
    return ok;
@@ -443,7 +447,7 @@ bool LiteEngine::generateBraces() {
                ln.rotate((l == 0) ? ln.get_S0() : ln.get_S1(), aDir * atan2(gw, ln.len()));
 
                // First intersect between line and inner rim
-               std::list<obj_line_intersect> iisects;
+               std::pmr::list<obj_line_intersect> iisects;
                if (!iro.line_intersect(ln, &iisects, true)) {
                   anchors[k].brace[b].isValid = false;
                   break;
@@ -455,7 +459,7 @@ bool LiteEngine::generateBraces() {
                // First intersect between line and outer rim
                ln.reverse();
                ln.extend_S1_mm(1e4);
-               std::list<obj_line_intersect> oisects;
+               std::pmr::list<obj_line_intersect> oisects;
                if (!ori.line_intersect(ln, &oisects, false)) {
                   anchors[k].brace[b].isValid = false;
                   break;
@@ -500,35 +504,51 @@ void LiteEngine::invalidateNarrowBracePairs() {
 }
 
 void LiteEngine::invalidateCrossingBraces() {
-   // Check for brace line crossings
-   for (int ko = 0; ko < nAnchors; ++ko)
-      for (int bo = 0; bo < 2; ++bo)
-         for (int lo = 0; lo < 2; ++lo)
-            for (int ki = 0; ki < nAnchors; ++ki)
-               for (int bi = 0; bi < 2; ++bi)
-                  for (int li = 0; li < 2; ++li)
-                     if ((ko != ki) || (bo != bi) || (lo != li)) { // Don't self compare
-                        if (anchors[ko].brace[bo].isValid && anchors[ki].brace[bi].isValid) {
-                           static constexpr double endShrink = 0.001;
-                           line lno = anchors[ko].brace[bo].brLine[lo].brLn;
-                           line lni = anchors[ki].brace[bi].brLine[li].brLn;
-                           lno.set(lno.get_pt(endShrink), lno.get_pt(1 - endShrink));
-                           lni.set(lni.get_pt(endShrink), lni.get_pt(1 - endShrink));
-                           coord_t i;
-                           if (lno.lines_intersect(lni, &i, false)) {
-                              DBGLVL2("Anchor: %d Brace: %d crosses Anchor: %d Brace: %d", ko, bo, ki, bi);
-                              // Invalidate the longest brace
-                              if (lno.len() > lni.len()) {
-                                 anchors[ko].brace[bo].isValid = false;
-                                 DBGLVL2("Anchor: %d Brace: %d invalidated", ko, bo);
-                              }
-                              else {
-                                 anchors[ki].brace[bi].isValid = false;
-                                 DBGLVL2("Anchor: %d Brace: %d invalidated", ki, bi);
-                              }
-                           }
-                        }
-                     }
+   // Find all the brace line crossings in one sweep, numbering the lines in anchor, brace, line order
+   static constexpr double endShrink = 0.001;
+   segment_sweep sw;
+   std::vector<int> lineNo;
+   std::vector<line> lines(4 * (size_t)nAnchors);
+   for (int k = 0; k < nAnchors; ++k)
+      for (int b = 0; b < 2; ++b)
+         for (int l = 0; l < 2; ++l) {
+            if (!anchors[k].brace[b].isValid)
+               continue;
+            int p = (((k * 2) + b) * 2) + l;
+            line& ln = lines[p];
+            ln = anchors[k].brace[b].brLine[l].brLn;
+            ln.set(ln.get_pt(endShrink), ln.get_pt(1 - endShrink));
+            sw.add(ln);
+            lineNo.push_back(p);
+         }
+   std::vector<segment_sweep::crossing> xs;
+   sw.crossings(xs);
+
+   // Visit each crossing from both sides in the same order as comparing every line with every other
+   std::vector<std::pair<int, int>> pairs;
+   pairs.reserve(2 * xs.size());
+   for (const segment_sweep::crossing& x : xs) {
+      pairs.emplace_back(lineNo[x.a], lineNo[x.b]);
+      pairs.emplace_back(lineNo[x.b], lineNo[x.a]);
+   }
+   std::sort(pairs.begin(), pairs.end());
+
+   for (const auto& [po, pi] : pairs) {
+      int ko = po / 4, bo = (po / 2) % 2;
+      int ki = pi / 4, bi = (pi / 2) % 2;
+      if (anchors[ko].brace[bo].isValid && anchors[ki].brace[bi].isValid) {
+         DBGLVL2("Anchor: %d Brace: %d crosses Anchor: %d Brace: %d", ko, bo, ki, bi);
+         // Invalidate the longest brace
+         if (lines[po].len() > lines[pi].len()) {
+            anchors[ko].brace[bo].isValid = false;
+            DBGLVL2("Anchor: %d Brace: %d invalidated", ko, bo);
+         }
+         else {
+            anchors[ki].brace[bi].isValid = false;
+            DBGLVL2("Anchor: %d Brace: %d invalidated", ki, bi);
+         }
+      }
+   }
 }
 
 void LiteEngine::drawValidBraces() {
@@ -576,7 +596,7 @@ void LiteEngine::openBraceGaps(bool iroNotOri) {
    obj& ob = iroNotOri ? iro : ori;
 
    for (auto g = gaps.begin(); g != gaps.end(); ++g)
-      DBGLVL2("Gap %lld: %lld %s %.2lf  %lld %s %.2lf", std::distance(gaps.begin(), g), ob.index(g->l0), g->p0.prstr(), g->l0->T_for_pt(g->p0), ob.index(g->l1), g->p1.prstr(), g->l1->T_for_pt(g->p1));
+      DBGLVL2("Gap %lld: %lld %s %.2lf  %lld %s %.2lf", std::distance(gaps.begin(), g), ob.index(g->l0), coordStr(g->p0).c_str(), g->l0->T_for_pt(g->p0), ob.index(g->l1), coordStr(g->p1).c_str(), g->l1->T_for_pt(g->p1));
 
    int removedCount;
    do {
@@ -616,7 +636,7 @@ void LiteEngine::openBraceGaps(bool iroNotOri) {
    } while (removedCount);
 
    for (auto g = gaps.begin(); g != gaps.end(); ++g)
-      DBGLVL2("Gap %lld: %lld %s %.2lf  %lld %s %.2lf", std::distance(gaps.begin(), g), ob.index(g->l0), g->p0.prstr(), g->l0->T_for_pt(g->p0), ob.index(g->l1), g->p1.prstr(), g->l1->T_for_pt(g->p1));
+      DBGLVL2("Gap %lld: %lld %s %.2lf  %lld %s %.2lf", std::distance(gaps.begin(), g), ob.index(g->l0), coordStr(g->p0).c_str(), g->l0->T_for_pt(g->p0), ob.index(g->l1), coordStr(g->p1).c_str(), g->l1->T_for_pt(g->p1));
 
    // Apply the gaps
    for (auto g = gaps.begin(); g != gaps.end(); ++g)
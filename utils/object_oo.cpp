@@ -18,7 +18,22 @@ along with this program.If not, see < https://www.gnu.org/licenses/>.
 #define _CRT_SECURE_NO_WARNINGS
 
 #define _USE_MATH_DEFINES
+#include <algorithm>
+#include <bit>
 #include <cmath>
+#include <limits>
+#include <queue>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define BATCH_AVX2
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
 
 #include "debug.h"
 #include "hpgl.h"
@@ -52,6 +67,12 @@ coord_t averageTwoPoints(coord_t c1, coord_t c2) {
    return coord_t{ (c1.x + c2.x) / 2.0, (c1.y + c2.y) / 2.0 };
 }
 
+std::string coordStr(coord_t c) {
+   char s[64];
+   snprintf(s, sizeof(s), "(%.2lf, %.2lf)", c.x, c.y);
+   return std::string(s);
+}
+
 double dotprodRaw(double x1, double y1, double x2, double y2) {
    return ((x1 * x2) + (y2 * y1));
 }
@@ -68,6 +89,91 @@ double perpprod(vector_t pt1, vector_t pt2) {
    return (perpprodRaw(pt1.dx, pt1.dy, pt2.dx, pt2.dy));
 }
 
+// Exact sum and product of two doubles as an unevaluated pair hi + lo
+static inline void twoSum(double a, double b, double& hi, double& lo) {
+   double s = a + b;
+   double bv = s - a;
+   double av = s - bv;
+   lo = (a - av) + (b - bv);
+   hi = s;
+}
+
+static inline void twoProduct(double a, double b, double& hi, double& lo) {
+   double p = a * b;
+   lo = std::fma(a, b, -p);
+   hi = p;
+}
+
+// Add b to the expansion h[0..n), kept as non-overlapping components in increasing order of magnitude
+static void growExpansion(double* h, size_t& n, double b) {
+   double q = b;
+   for (size_t k = 0; k < n; k++)
+      twoSum(q, h[k], q, h[k]);
+   h[n++] = q;
+}
+
+double orient2d(coord_t a, coord_t b, coord_t c) {
+   double detl = (a.x - c.x) * (b.y - c.y);
+   double detr = (a.y - c.y) * (b.x - c.x);
+   double det = detl - detr;
+
+   // The rounded determinant has the right sign unless it is within its error bound of zero (Shewchuk)
+   double detsum;
+   if (detl > 0.0) {
+      if (detr <= 0.0)
+         return det;
+      detsum = detl + detr;
+   }
+   else if (detl < 0.0) {
+      if (detr >= 0.0)
+         return det;
+      detsum = -detl - detr;
+   }
+   else
+      return det;
+   const double eps = std::numeric_limits<double>::epsilon() / 2.0;
+   if (std::abs(det) >= ((3.0 + (16.0 * eps)) * eps * detsum))
+      return det;
+
+   // Otherwise sum the six products of the expanded determinant exactly; the largest component carries the sign
+   const double f[6][2] = { { a.x, b.y }, { -a.x, c.y }, { -c.x, b.y }, { -a.y, b.x }, { a.y, c.x }, { c.y, b.x } };
+   double h[12];
+   size_t n = 0;
+   for (const auto& pr : f) {
+      double hi, lo;
+      twoProduct(pr[0], pr[1], hi, lo);
+      growExpansion(h, n, lo);
+      growExpansion(h, n, hi);
+   }
+   for (size_t k = n; k-- > 0;)
+      if (h[k] != 0.0)
+         return h[k];
+   return 0.0;
+}
+
+// True if pt, known to be collinear with a-b, lies between them
+static bool inSpan(coord_t a, coord_t b, coord_t pt) {
+   return (pt.x >= std::min(a.x, b.x)) && (pt.x <= std::max(a.x, b.x)) && (pt.y >= std::min(a.y, b.y)) &&
+      (pt.y <= std::max(a.y, b.y));
+}
+
+cross_e segmentsCross(coord_t a0, coord_t a1, coord_t b0, coord_t b1) {
+   double o0 = orient2d(b0, b1, a0);
+   double o1 = orient2d(b0, b1, a1);
+   double o2 = orient2d(a0, a1, b0);
+   double o3 = orient2d(a0, a1, b1);
+
+   if ((((o0 > 0.0) && (o1 < 0.0)) || ((o0 < 0.0) && (o1 > 0.0))) &&
+      (((o2 > 0.0) && (o3 < 0.0)) || ((o2 < 0.0) && (o3 > 0.0))))
+      return CROSS_PROPER;
+
+   if (((o0 == 0.0) && inSpan(b0, b1, a0)) || ((o1 == 0.0) && inSpan(b0, b1, a1)) ||
+      ((o2 == 0.0) && inSpan(a0, a1, b0)) || ((o3 == 0.0) && inSpan(a0, a1, b1)))
+      return CROSS_TOUCH;
+
+   return CROSS_NONE;
+}
+
 double slotWidth(const line& crossLine, const line& slottedLine, double crossThck, double slottedThck) {
    double wCross = crossLine.angle();
    double wSlotd = slottedLine.angle();
@@ -90,6 +196,41 @@ void rotatePoint(coord_t* pt, coord_t pivot, double rads) {
    pt->y = pivot.y + (vec.x * unit.y) + (vec.y * unit.x);
 }
 
+affine_t affine_t::translate(double dx, double dy) {
+   affine_t m;
+   m.tx = dx;
+   m.ty = dy;
+   return m;
+}
+
+affine_t affine_t::rotate(coord_t pivot, double rads) {
+   affine_t m;
+   m.a = m.d = cos(rads);
+   m.c = sin(rads);
+   m.b = -m.c;
+   m.tx = pivot.x - ((pivot.x * m.a) + (pivot.y * m.b));
+   m.ty = pivot.y - ((pivot.x * m.c) + (pivot.y * m.d));
+   return m;
+}
+
+affine_t affine_t::scale(double sx, double sy) {
+   affine_t m;
+   m.a = sx;
+   m.d = sy;
+   return m;
+}
+
+affine_t affine_t::then(const affine_t& m) const {
+   affine_t r;
+   r.a = (m.a * a) + (m.b * c);
+   r.b = (m.a * b) + (m.b * d);
+   r.c = (m.c * a) + (m.d * c);
+   r.d = (m.c * b) + (m.d * d);
+   r.tx = (m.a * tx) + (m.b * ty) + m.tx;
+   r.ty = (m.c * tx) + (m.d * ty) + m.ty;
+   return r;
+}
+
 bool obj_sort_left_right(const obj& a, const obj& b) {
    obj cpya = a;
    obj cpyb = b;
@@ -209,7 +350,7 @@ double line::angle() const {
    return (atan2(V.dy, V.dx));
 }
 
-double line::angle(line& l2) {
+double line::angle(const line& l2) const {
    if ((len() > 0.0) && (l2.len() > 0.0))
       return atan2(perpprod(V, l2.get_V()), dotprod(V, l2.get_V()));
    else
@@ -321,6 +462,15 @@ bool line::lines_intersect(const line& l2, coord_t* i, int allowExtrapolation) c
 
    // Check for lines being parallel
    if (((perpl1l2 < 0) && (perpl1l2 > (-SMALL_NUM))) || ((perpl1l2 >= 0) && (perpl1l2 < SMALL_NUM))) {
+      // Short segments can fall inside that limit and still cross; the exact test finds them, and the ratio of the
+      // end orientations places the crossing without dividing by the tiny cross product
+      if (!allowExtrapolation && (segmentsCross(S0, get_S1(), l2.S0, l2.get_S1()) == CROSS_PROPER)) {
+         double o0 = orient2d(l2.S0, l2.get_S1(), S0);
+         double o1 = orient2d(l2.S0, l2.get_S1(), get_S1());
+         *i = get_pt(o0 / (o0 - o1));
+         return (true);
+      }
+
       double dotl1 = dotprod(V, V);
       double dotl2 = dotprod(l2.V, l2.V);
       double perpl1w = perpprod(V, w);
@@ -473,6 +623,17 @@ void line::mirror_y() {
    V.dy = -V.dy;
 }
 
+void line::transform(const affine_t& m) {
+   // A plain move leaves the vector alone, exactly as add_offset() does
+   if (m.is_translation()) {
+      add_offset(m.tx, m.ty);
+      return;
+   }
+   coord_t s0 = { (m.a * S0.x) + (m.b * S0.y) + m.tx, (m.c * S0.x) + (m.d * S0.y) + m.ty };
+   V = { (m.a * V.dx) + (m.b * V.dy), (m.c * V.dx) + (m.d * V.dy) };
+   S0 = s0;
+}
+
 void line::reverse() {
    S0 = get_S1();
    V.dx = -V.dx;
@@ -508,39 +669,869 @@ void line::extend_mm(double mm) {
    extend_S1_mm(mm);
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// LINE STORE
+/////////////////////////////////////////////////////////////////////////////////////////////////
+line_store::line_store()
+   : p(std::make_shared<pool>()) {
+   p->nd.resize(1);
+   p->nd[HEAD].prv = HEAD;
+   p->nd[HEAD].nxt = HEAD;
+   rebind();
+}
+
+line_store::line_store(const line_store& s)
+   : p(s.p),
+   nds(s.nds),
+   tf(s.tf),
+   tfPending(s.tfPending) {
+}
+
+line_store& line_store::operator=(const line_store& s) {
+   if (this == &s)
+      return *this;
+
+   // Share the nodes, and the transform still to be applied to them
+   p = s.p;
+   rebind();
+   tf = s.tf;
+   tfPending = s.tfPending;
+   rankValid = false;
+   return *this;
+}
+
+void line_store::own() {
+   if (tfPending)
+      settle();
+   if (p.use_count() > 1) {
+      p = std::make_shared<pool>(*p);
+      rebind();
+   }
+}
+
+void line_store::unlink(uint32_t n) {
+   std::vector<node>& nd = p->nd;
+   nd[nd[n].prv].nxt = nd[n].nxt;
+   nd[nd[n].nxt].prv = nd[n].prv;
+}
+
+void line_store::link(uint32_t pos, uint32_t n) {
+   std::vector<node>& nd = p->nd;
+   nd[n].nxt = pos;
+   nd[n].prv = nd[pos].prv;
+   nd[nd[pos].prv].nxt = n;
+   nd[pos].prv = n;
+}
+
+uint32_t line_store::insert(uint32_t pos, line ln) {
+   // The new element is already where it should be, so the others must catch up first
+   own();
+
+   uint32_t n;
+   if (p->freed.empty()) {
+      n = (uint32_t)p->nd.size();
+      p->nd.push_back(node{ ln, HEAD, HEAD });
+      rebind();
+   }
+   else {
+      n = p->freed.back();
+      p->freed.pop_back();
+      p->nd[n].ln = ln;
+   }
+   link(pos, n);
+
+   // Appending is the common case and leaves the positions of the other elements untouched
+   if (rankValid && (pos == HEAD)) {
+      rank.resize(p->nd.size());
+      rank[n] = (uint32_t)p->cnt;
+      rank[HEAD] = (uint32_t)(p->cnt + 1);
+   }
+   else
+      rankValid = false;
+
+   p->cnt++;
+   return n;
+}
+
+void line_store::erase(uint32_t n) {
+   own();
+   unlink(n);
+   p->freed.push_back(n);
+   p->cnt--;
+   rankValid = false;
+}
+
+void line_store::move(uint32_t pos, uint32_t n) {
+   if (n == pos)
+      return;
+   own();
+   unlink(n);
+   link(pos, n);
+   rankValid = false;
+}
+
+void line_store::clear() {
+   // A shared pool is left to the copies rather than emptied
+   if (p.use_count() > 1)
+      p = std::make_shared<pool>();
+   p->nd.resize(1);
+   p->nd[HEAD].prv = HEAD;
+   p->nd[HEAD].nxt = HEAD;
+   p->freed.clear();
+   p->cnt = 0;
+   rebind();
+   rankValid = false;
+   tf = {};
+   tfPending = false;
+}
+
+void line_store::reserve(size_t n) {
+   own();
+   p->nd.reserve(n + 1);
+   rebind();
+}
+
+size_t line_store::position(uint32_t n) const {
+   if (!rankValid) {
+      rank.resize(p->nd.size());
+      uint32_t r = 0;
+      for (uint32_t k = first(); k != HEAD; k = next(k))
+         rank[k] = r++;
+      rank[HEAD] = r;
+      rankValid = true;
+   }
+   return rank[n];
+}
+
+void line_store::transform(const affine_t& m) {
+   if (!p->cnt)
+      return;
+   tf = tf.then(m);
+   tfPending = !tf.is_identity();
+}
+
+void line_store::settle() const {
+   // The copies sharing the pool keep the untransformed nodes
+   if (p.use_count() > 1) {
+      p = std::make_shared<pool>(*p);
+      rebind();
+   }
+
+   // Recycled nodes are transformed too; it is cheaper than walking the path and they are overwritten on reuse
+   for (uint32_t n = HEAD + 1; n < p->nd.size(); n++)
+      p->nd[n].ln.transform(tf);
+   tf = {};
+   tfPending = false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// LINE INDEX
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void line_index::build(const line_store& s) {
+   clear();
+   items.reserve(s.size());
+   for (uint32_t n = s.first(); n != line_store::HEAD; n = s.next(n)) {
+      coord_t s0 = s.at(n).get_S0();
+      coord_t s1 = s.at(n).get_S1();
+      items.push_back(item{ box{ std::min(s0.x, s1.x) - INDEX_PAD, std::min(s0.y, s1.y) - INDEX_PAD,
+                                 std::max(s0.x, s1.x) + INDEX_PAD, std::max(s0.y, s1.y) + INDEX_PAD },
+                            n });
+   }
+   if (!items.empty()) {
+      nodes.reserve(2 * ((items.size() / INDEX_LEAF_SIZE) + 1));
+      build(0, (uint32_t)items.size());
+   }
+}
+
+void line_index::clear() {
+   items.clear();
+   nodes.clear();
+}
+
+uint32_t line_index::build(uint32_t lo, uint32_t hi) {
+   uint32_t k = (uint32_t)nodes.size();
+   nodes.push_back(bnode{});
+
+   box b = items[lo].b;
+   for (uint32_t i = lo + 1; i < hi; i++) {
+      b.x0 = std::min(b.x0, items[i].b.x0);
+      b.y0 = std::min(b.y0, items[i].b.y0);
+      b.x1 = std::max(b.x1, items[i].b.x1);
+      b.y1 = std::max(b.y1, items[i].b.y1);
+   }
+   nodes[k].b = b;
+
+   if ((hi - lo) <= INDEX_LEAF_SIZE) {
+      nodes[k].leaf = true;
+      nodes[k].lft = lo;
+      nodes[k].rgt = hi - lo;
+      return k;
+   }
+
+   // Split at the median element centre along the longer side of the box
+   bool xsplit = ((b.x1 - b.x0) >= (b.y1 - b.y0));
+   uint32_t mid = lo + ((hi - lo) / 2);
+   std::nth_element(items.begin() + lo, items.begin() + mid, items.begin() + hi,
+      [xsplit](const item& a, const item& c) {
+         return xsplit ? ((a.b.x0 + a.b.x1) < (c.b.x0 + c.b.x1)) : ((a.b.y0 + a.b.y1) < (c.b.y0 + c.b.y1));
+      });
+
+   uint32_t l = build(lo, mid);
+   uint32_t r = build(mid, hi);
+   nodes[k].leaf = false;
+   nodes[k].lft = l;
+   nodes[k].rgt = r;
+   return k;
+}
+
+// Test if the segment p + t.d, t[0..1] passes through box b
+bool line_index::crosses(const box& b, coord_t p, vector_t d) {
+   double lo[2] = { b.x0, b.y0 };
+   double hi[2] = { b.x1, b.y1 };
+   double o[2] = { p.x, p.y };
+   double v[2] = { d.dx, d.dy };
+   double t0 = 0.0, t1 = 1.0;
+
+   for (int a = 0; a < 2; a++) {
+      if (v[a] == 0.0) {
+         if ((o[a] < lo[a]) || (o[a] > hi[a]))
+            return false;
+         continue;
+      }
+      double ta = (lo[a] - o[a]) / v[a];
+      double tb = (hi[a] - o[a]) / v[a];
+      if (ta > tb)
+         std::swap(ta, tb);
+      t0 = std::max(t0, ta);
+      t1 = std::min(t1, tb);
+      if (t0 > t1)
+         return false;
+   }
+   return true;
+}
+
+void line_index::candidates(const line& ln, std::vector<uint32_t>& out) const {
+   out.clear();
+   if (nodes.empty())
+      return;
+
+   coord_t p = ln.get_S0();
+   vector_t d = ln.get_V();
+   uint32_t stack[64];
+   size_t sp = 0;
+   stack[sp++] = 0;
+   while (sp) {
+      const bnode& nd = nodes[stack[--sp]];
+      if (!crosses(nd.b, p, d))
+         continue;
+      if (nd.leaf) {
+         for (uint32_t i = nd.lft; i < nd.lft + nd.rgt; i++)
+            if (crosses(items[i].b, p, d))
+               out.push_back(items[i].n);
+      }
+      else {
+         stack[sp++] = nd.rgt;
+         stack[sp++] = nd.lft;
+      }
+   }
+}
+
+void line_index::near(coord_t pt, double dist, std::vector<uint32_t>& out) const {
+   out.clear();
+   if (nodes.empty())
+      return;
+
+   auto reaches = [pt, dist](const box& b) {
+      return (pt.x >= (b.x0 - dist)) && (pt.x <= (b.x1 + dist)) && (pt.y >= (b.y0 - dist)) && (pt.y <= (b.y1 + dist));
+   };
+   uint32_t stack[64];
+   size_t sp = 0;
+   stack[sp++] = 0;
+   while (sp) {
+      const bnode& nd = nodes[stack[--sp]];
+      if (!reaches(nd.b))
+         continue;
+      if (nd.leaf) {
+         for (uint32_t i = nd.lft; i < nd.lft + nd.rgt; i++)
+            if (reaches(items[i].b))
+               out.push_back(items[i].n);
+      }
+      else {
+         stack[sp++] = nd.rgt;
+         stack[sp++] = nd.lft;
+      }
+   }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// X SLAB INDEX
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool x_slab_index::build(const line_store& s) {
+   clear();
+
+   // Slab boundaries are the padded x extents of every element
+   edge.reserve(2 * s.size());
+   for (uint32_t n = s.first(); n != line_store::HEAD; n = s.next(n)) {
+      double x0 = s.at(n).get_S0().x;
+      double x1 = s.at(n).get_S1().x;
+      edge.push_back(std::min(x0, x1) - INDEX_PAD);
+      edge.push_back(std::max(x0, x1) + INDEX_PAD);
+   }
+   std::sort(edge.begin(), edge.end());
+   edge.erase(std::unique(edge.begin(), edge.end()), edge.end());
+   if (edge.size() < 2) {
+      edge.clear();
+      return false;
+   }
+
+   // Count the elements spanning each slab, then lay the slabs out one after another
+   size_t nslab = edge.size() - 1;
+   start.assign(nslab + 1, 0);
+   size_t total = 0;
+   for (uint32_t n = s.first(); n != line_store::HEAD; n = s.next(n)) {
+      double x0 = s.at(n).get_S0().x;
+      double x1 = s.at(n).get_S1().x;
+      size_t j0 = std::lower_bound(edge.begin(), edge.end(), std::min(x0, x1) - INDEX_PAD) - edge.begin();
+      size_t j1 = std::lower_bound(edge.begin(), edge.end(), std::max(x0, x1) + INDEX_PAD) - edge.begin();
+      for (size_t j = j0; j < j1; j++)
+         start[j + 1]++;
+      total += j1 - j0;
+      if (total > (SLAB_MAX_ENTRIES * s.size())) {
+         clear();
+         tooBig = true;
+         return false;
+      }
+   }
+   for (size_t j = 0; j < nslab; j++)
+      start[j + 1] += start[j];
+
+   std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+   nodes.resize(total);
+   for (uint32_t n = s.first(); n != line_store::HEAD; n = s.next(n)) {
+      double x0 = s.at(n).get_S0().x;
+      double x1 = s.at(n).get_S1().x;
+      size_t j0 = std::lower_bound(edge.begin(), edge.end(), std::min(x0, x1) - INDEX_PAD) - edge.begin();
+      size_t j1 = std::lower_bound(edge.begin(), edge.end(), std::max(x0, x1) + INDEX_PAD) - edge.begin();
+      for (size_t j = j0; j < j1; j++)
+         nodes[fill[j]++] = n;
+   }
+   return true;
+}
+
+void x_slab_index::clear() {
+   edge.clear();
+   start.clear();
+   nodes.clear();
+   tooBig = false;
+}
+
+size_t x_slab_index::candidates(double x, const uint32_t** first) const {
+   // Slab j runs from edge[j] up to edge[j + 1]
+   size_t j = std::upper_bound(edge.begin(), edge.end(), x) - edge.begin();
+   if ((j == 0) || (j >= edge.size()))
+      return 0;
+   j--;
+   *first = nodes.data() + start[j];
+   return start[j + 1] - start[j];
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// ENDPOINT GRID
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void endpoint_grid::build(const line_store& s, uint32_t from, double snaplen) {
+   cell = (snaplen > 0.0) ? snaplen : SNAP_LEN;
+   cellOf.clear();
+   cellOf.reserve(2 * s.size());
+   start.clear();
+   nodes.clear();
+
+   // Number the occupied cells and count the ends in each, then lay the cells out one after another
+   std::vector<uint32_t> endCell;
+   endCell.reserve(2 * s.size());
+   for (uint32_t n = from; n != line_store::HEAD; n = s.next(n)) {
+      for (coord_t pt : { s.at(n).get_S0(), s.at(n).get_S1() }) {
+         uint64_t k = key((int64_t)std::floor(pt.x / cell), (int64_t)std::floor(pt.y / cell));
+         auto [it, isNew] = cellOf.try_emplace(k, (uint32_t)start.size());
+         if (isNew)
+            start.push_back(0);
+         start[it->second]++;
+         endCell.push_back(it->second);
+      }
+   }
+   uint32_t total = 0;
+   for (uint32_t& c : start) {
+      uint32_t cnt = c;
+      c = total;
+      total += cnt;
+   }
+   start.push_back(total);
+
+   std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+   nodes.resize(total);
+   size_t k = 0;
+   for (uint32_t n = from; n != line_store::HEAD; n = s.next(n)) {
+      nodes[fill[endCell[k++]]++] = n;
+      nodes[fill[endCell[k++]]++] = n;
+   }
+}
+
+void endpoint_grid::near(coord_t pt, std::vector<uint32_t>& out) const {
+   int64_t ci = (int64_t)std::floor(pt.x / cell);
+   int64_t cj = (int64_t)std::floor(pt.y / cell);
+   for (int64_t i = ci - 1; i <= ci + 1; i++)
+      for (int64_t j = cj - 1; j <= cj + 1; j++) {
+         auto it = cellOf.find(key(i, j));
+         if (it != cellOf.end())
+            out.insert(out.end(), nodes.begin() + start[it->second], nodes.begin() + start[it->second + 1]);
+      }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// SEGMENT BATCH
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// One pair as line a.lines_intersect(b) tests it, with the same operations in the same order so that T is identical
+static inline uint8_t batchLane(double ax, double ay, double adx, double ady,
+   double bx, double by, double bdx, double bdy, double* t) {
+   double wx = ax - bx;
+   double wy = ay - by;
+   double perp = (adx * bdy) - (bdx * ady);
+   if ((perp > -SMALL_NUM) && (perp < SMALL_NUM))
+      return segment_batch::PARALLEL;
+
+   double s1I = ((bdx * wy) - (wx * bdy)) / perp;
+   double s2I = ((adx * wy) - (wx * ady)) / perp;
+   *t = s1I;
+   return ((s1I < 0) || (s1I > 1) || (s2I < 0) || (s2I > 1)) ? segment_batch::MISS : segment_batch::HIT;
+}
+
+// Packed segment arrays and the query line for a batch kernel
+struct batch_args {
+   const double* s[4]; //!< S0.x, S0.y, V.dx and V.dy of the segments
+   coord_t q0;
+   vector_t qv;
+   bool qFirst;
+};
+
+static void batchScalar(const batch_args& a, const uint32_t* idx, size_t first, size_t cnt, uint8_t* res, double* t) {
+   for (size_t k = 0; k < cnt; k++) {
+      size_t n = idx ? idx[k] : (first + k);
+      if (a.qFirst)
+         res[k] = batchLane(a.q0.x, a.q0.y, a.qv.dx, a.qv.dy, a.s[0][n], a.s[1][n], a.s[2][n], a.s[3][n], &t[k]);
+      else
+         res[k] = batchLane(a.s[0][n], a.s[1][n], a.s[2][n], a.s[3][n], a.q0.x, a.q0.y, a.qv.dx, a.qv.dy, &t[k]);
+   }
+}
+
+#ifdef BATCH_AVX2
+// Four lanes of batchLane() at a time; there is no FMA so every product is rounded exactly as the scalar code rounds it
+TARGET_AVX2 static void batchAvx2(const batch_args& a, const uint32_t* idx, size_t first, size_t cnt, uint8_t* res, double* t) {
+   const __m256d q0x = _mm256_set1_pd(a.q0.x);
+   const __m256d q0y = _mm256_set1_pd(a.q0.y);
+   const __m256d qdx = _mm256_set1_pd(a.qv.dx);
+   const __m256d qdy = _mm256_set1_pd(a.qv.dy);
+   const __m256d lo = _mm256_set1_pd(-SMALL_NUM);
+   const __m256d hi = _mm256_set1_pd(SMALL_NUM);
+   const __m256d zero = _mm256_setzero_pd();
+   const __m256d one = _mm256_set1_pd(1.0);
+
+   size_t k = 0;
+   for (; (k + 4) <= cnt; k += 4) {
+      __m256d p[4];
+      for (int c = 0; c < 4; c++) {
+         const double* v = a.s[c];
+         p[c] = idx ? _mm256_set_pd(v[idx[k + 3]], v[idx[k + 2]], v[idx[k + 1]], v[idx[k]]) : _mm256_loadu_pd(v + first + k);
+      }
+      __m256d ax = a.qFirst ? q0x : p[0], ay = a.qFirst ? q0y : p[1], adx = a.qFirst ? qdx : p[2], ady = a.qFirst ? qdy : p[3];
+      __m256d bx = a.qFirst ? p[0] : q0x, by = a.qFirst ? p[1] : q0y, bdx = a.qFirst ? p[2] : qdx, bdy = a.qFirst ? p[3] : qdy;
+
+      __m256d wx = _mm256_sub_pd(ax, bx);
+      __m256d wy = _mm256_sub_pd(ay, by);
+      __m256d perp = _mm256_sub_pd(_mm256_mul_pd(adx, bdy), _mm256_mul_pd(bdx, ady));
+      __m256d par = _mm256_and_pd(_mm256_cmp_pd(perp, lo, _CMP_GT_OQ), _mm256_cmp_pd(perp, hi, _CMP_LT_OQ));
+      __m256d s1I = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(bdx, wy), _mm256_mul_pd(wx, bdy)), perp);
+      __m256d s2I = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(adx, wy), _mm256_mul_pd(wx, ady)), perp);
+      __m256d out = _mm256_or_pd(_mm256_or_pd(_mm256_cmp_pd(s1I, zero, _CMP_LT_OQ), _mm256_cmp_pd(s1I, one, _CMP_GT_OQ)),
+         _mm256_or_pd(_mm256_cmp_pd(s2I, zero, _CMP_LT_OQ), _mm256_cmp_pd(s2I, one, _CMP_GT_OQ)));
+      _mm256_storeu_pd(t + k, s1I);
+
+      int mp = _mm256_movemask_pd(par);
+      int mo = _mm256_movemask_pd(out);
+      for (int l = 0; l < 4; l++)
+         res[k + l] = ((mp >> l) & 1) ? segment_batch::PARALLEL : ((mo >> l) & 1) ? segment_batch::MISS : segment_batch::HIT;
+   }
+   if (k < cnt)
+      batchScalar(a, idx ? (idx + k) : nullptr, first + k, cnt - k, res + k, t + k);
+}
+
+static bool hasAvx2() {
+#if defined(_MSC_VER)
+   int r[4];
+   __cpuid(r, 0);
+   if (r[0] < 7)
+      return false;
+   __cpuid(r, 1);
+   if (!(r[2] & (1 << 27)) || ((_xgetbv(0) & 6) != 6)) // OS saves the AVX registers
+      return false;
+   __cpuidex(r, 7, 0);
+   return (r[1] & (1 << 5)) != 0;
+#else
+   return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+typedef void (*batch_kernel)(const batch_args& a, const uint32_t* idx, size_t first, size_t cnt, uint8_t* res, double* t);
+
+// The fastest kernel this processor can run for cnt segments; the vector kernel is chosen on first use
+static batch_kernel batchKernel(size_t cnt) {
+#ifdef BATCH_AVX2
+   static const batch_kernel k = hasAvx2() ? batchAvx2 : batchScalar;
+   if (cnt >= 4)
+      return k;
+#endif
+   return batchScalar;
+}
+
+void segment_batch::clear() {
+   sx.clear();
+   sy.clear();
+   vx.clear();
+   vy.clear();
+}
+
+void segment_batch::reserve(size_t n) {
+   sx.reserve(n);
+   sy.reserve(n);
+   vx.reserve(n);
+   vy.reserve(n);
+}
+
+void segment_batch::add(const line& ln) {
+   sx.push_back(ln.get_S0().x);
+   sy.push_back(ln.get_S0().y);
+   vx.push_back(ln.get_V().dx);
+   vy.push_back(ln.get_V().dy);
+}
+
+void segment_batch::intersect(const line& q, bool qFirst, size_t first, size_t cnt, uint8_t* res, double* t) const {
+   if ((first + cnt) > size())
+      FATAL("Segment batch range out of bounds");
+   batch_args a = { { sx.data(), sy.data(), vx.data(), vy.data() }, q.get_S0(), q.get_V(), qFirst };
+   batchKernel(cnt)(a, nullptr, first, cnt, res, t);
+}
+
+void segment_batch::intersect_listed(const line& q, bool qFirst, const uint32_t* idx, size_t cnt, uint8_t* res, double* t) const {
+   batch_args a = { { sx.data(), sy.data(), vx.data(), vy.data() }, q.get_S0(), q.get_V(), qFirst };
+   batchKernel(cnt)(a, idx, 0, cnt, res, t);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// SEGMENT SWEEP
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void segment_sweep::clear() {
+   segs.clear();
+}
+
+void segment_sweep::reserve(size_t n) {
+   segs.reserve(n);
+}
+
+uint32_t segment_sweep::add(const line& ln, uint32_t group) {
+   coord_t s0 = ln.get_S0();
+   coord_t s1 = ln.get_S1();
+   segs.push_back(seg{ ln,
+      std::min(s0.x, s1.x) - INDEX_PAD, std::min(s0.y, s1.y) - INDEX_PAD,
+      std::max(s0.x, s1.x) + INDEX_PAD, std::max(s0.y, s1.y) + INDEX_PAD,
+      group });
+   return (uint32_t)(segs.size() - 1);
+}
+
+size_t segment_sweep::crossings(std::vector<crossing>& out, bool betweenGroups, size_t maxCount) const {
+   out.clear();
+   if (!maxCount)
+      return 0;
+
+   std::pmr::vector<uint32_t> order(segs.size());
+   for (uint32_t k = 0; k < order.size(); k++)
+      order[k] = k;
+   std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+      return (segs[a].x0 < segs[b].x0) || ((segs[a].x0 == segs[b].x0) && (a < b));
+   });
+
+   // Test each segment against those still spanning its left end, dropping the ones left behind
+   std::pmr::vector<uint32_t> active;
+   for (uint32_t s : order) {
+      const seg& cs = segs[s];
+      size_t keep = 0;
+      for (size_t k = 0; k < active.size(); k++) {
+         const seg& as = segs[active[k]];
+         if (as.x1 < cs.x0)
+            continue;
+         active[keep++] = active[k];
+
+         if ((as.y1 < cs.y0) || (as.y0 > cs.y1) || (betweenGroups && (as.group == cs.group)))
+            continue;
+         uint32_t a = std::min(s, active[keep - 1]);
+         uint32_t b = std::max(s, active[keep - 1]);
+         coord_t pt;
+         if (segs[a].ln.lines_intersect(segs[b].ln, &pt, 0)) {
+            out.push_back(crossing{ a, b, pt });
+            if (out.size() >= maxCount)
+               break;
+         }
+      }
+      if (out.size() >= maxCount)
+         break;
+      active.resize(keep);
+      active.push_back(s);
+   }
+
+   std::sort(out.begin(), out.end(), [](const crossing& p, const crossing& q) {
+      return (p.a < q.a) || ((p.a == q.a) && (p.b < q.b));
+   });
+   return out.size();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// GEOMETRY ARENA
+/////////////////////////////////////////////////////////////////////////////////////////////////
+geom_arena* geom_arena::top = nullptr;
+
+geom_arena::geom_arena()
+   : pool(std::pmr::new_delete_resource()),
+   below(top) {
+   top = this;
+   std::pmr::set_default_resource(&pool);
+}
+
+geom_arena::~geom_arena() {
+   // Each pool draws straight from the heap, so an arena can be unlinked wherever it sits in the stack
+   geom_arena** pp = &top;
+   while (*pp != this)
+      pp = &(*pp)->below;
+   *pp = below;
+   std::pmr::set_default_resource(top ? &top->pool : std::pmr::new_delete_resource());
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////
 // OBJ
 /////////////////////////////////////////////////////////////////////////////////////////////////
 // Constructors
+// Copies share the nodes of the original until either changes them, so the bounding box carries over too
+obj::obj(const obj& o)
+   : e(std::make_unique<line_store>(*o.e)),
+   bb(o.bb),
+   testFlag(o.testFlag) {
+   ix_copy_norm(o);
+}
+
+obj::obj(obj&& o)
+   : e(std::move(o.e)),
+   bb(o.bb),
+   ix(std::move(o.ix)),
+   testFlag(o.testFlag) {
+   o.e = std::make_unique<line_store>();
+   o.bb.valid = false;
+   o.ix_invalidate();
+}
+
+obj& obj::operator=(const obj& o) {
+   if (this == &o)
+      return *this;
+   *e = *o.e;
+   bb = o.bb;
+   ix_invalidate();
+   ix_copy_norm(o);
+   testFlag = o.testFlag;
+   return *this;
+}
+
+obj& obj::operator=(obj&& o) {
+   if (this != &o) {
+      e.swap(o.e);
+      o.e->clear();
+      bb = o.bb;
+      o.bb.valid = false;
+      std::swap(ix, o.ix);
+      o.ix_invalidate();
+      testFlag = o.testFlag;
+   }
+   return *this;
+}
+
 obj::obj(coord_t s0, coord_t s1) {
-   e.emplace_back(s0, s1);
+   add(s0, s1);
 }
 
 obj::obj(coord_t s0, vector_t v0) {
-   e.emplace_back(s0, v0);
+   add(s0, v0);
 }
 
 obj::obj(line ln) {
-   e.emplace_back(ln);
+   add(ln);
+}
+
+line& obj::ref(line_iter ln) {
+   if ((ln.s != e.get()) || (ln.n == line_store::HEAD))
+      FATAL("Element does not belong to this object");
+   bb.valid = false;
+   ix_invalidate();
+   return e->edit(ln.n);
+}
+
+void obj::ix_invalidate(uint8_t keep) const {
+   if (ix.lines)
+      ix.lines->clear();
+   if (ix.slabs)
+      ix.slabs->clear();
+   if (ix.batch)
+      ix.batch->clear();
+   ix.lengths.clear();
+   ix.norm &= keep;
+   if (!(ix.norm & NORM_PATHS))
+      ix.paths.clear();
+   ix.lineQueries = 0;
+   ix.slabQueries = 0;
+}
+
+void obj::ix_copy_norm(const obj& o) const {
+   // Shared copies have the same node numbers, so the paths still apply
+   if (this != &o) {
+      ix.norm = o.ix.norm;
+      ix.paths = o.ix.paths;
+      ix.pathSnap = o.ix.pathSnap;
+   }
+}
+
+const line_index* obj::indexed(size_t nq) const {
+   if (size() < INDEX_MIN_ELEMENTS)
+      return nullptr;
+
+   // Building costs a few scans of the elements, so only do it once the queries will pay for it
+   if (!ix.lines || !ix.lines->valid()) {
+      ix.lineQueries += nq;
+      if (ix.lineQueries < INDEX_MIN_QUERIES)
+         return nullptr;
+      if (!ix.lines)
+         ix.lines = std::make_unique<line_index>();
+      ix.lines->build(*e);
+   }
+   return ix.lines.get();
+}
+
+const x_slab_index* obj::slab_indexed() const {
+   if (size() < INDEX_MIN_ELEMENTS)
+      return nullptr;
+
+   if (!ix.slabs || !ix.slabs->valid()) {
+      if (ix.slabs && ix.slabs->oversize())
+         return nullptr;
+      if (++ix.slabQueries < INDEX_MIN_QUERIES)
+         return nullptr;
+      if (!ix.slabs)
+         ix.slabs = std::make_unique<x_slab_index>();
+      if (!ix.slabs->build(*e))
+         return nullptr;
+   }
+   return ix.slabs.get();
+}
+
+bool obj::is_clear_of(coord_t pt, double d) const {
+   const line_index* idx = indexed(1);
+   if (idx) {
+      std::vector<uint32_t> cand;
+      idx->near(pt, d, cand);
+      for (uint32_t n : cand)
+         if (e->at(n).distance_to_point(pt) < d)
+            return false;
+      return true;
+   }
+
+   for (line_iter ln = begin(); ln != end(); ++ln)
+      if (ln->distance_to_point(pt) < d)
+         return false;
+   return true;
+}
+
+const segment_batch& obj::batched() const {
+   if (!ix.batch)
+      ix.batch = std::make_unique<segment_batch>();
+   if (!ix.batch->size()) {
+      ix.batch->reserve(e->pool_size());
+      for (uint32_t n = 0; n < e->pool_size(); n++)
+         ix.batch->add(e->at(n));
+   }
+   return *ix.batch;
+}
+
+const std::vector<obj::length_step>& obj::length_table() const {
+   if (ix.lengths.empty() && !empty()) {
+      ix.lengths.reserve(size());
+      double l = 0.0;
+      for (uint32_t n = e->first(); n != line_store::HEAD; n = e->next(n)) {
+         double ll = e->at(n).len();
+         ix.lengths.push_back(length_step{ l, ll, n });
+         l += ll;
+      }
+   }
+   return ix.lengths;
+}
+
+void obj::index_candidates(const line& ln, const line_index* idx, std::vector<uint32_t>& out) const {
+   idx->candidates(ln, out);
+   std::sort(out.begin(), out.end(), [this](uint32_t a, uint32_t b) { return e->position(a) < e->position(b); });
+}
+
+void obj::bb_reset() const {
+   bb.ext[LEFT] = bb.ext[DOWN] = HUGE;
+   bb.ext[RIGHT] = bb.ext[UP] = -HUGE;
+   for (size_t dir = LEFT; dir <= DOWN; dir++) {
+      bb.ptu[dir] = bb.ptd[dir] = coord_t{ 0.0, 0.0 };
+      bb.elm[dir] = line_store::HEAD;
+   }
+   bb.valid = true;
+}
+
+void obj::bb_include(uint32_t n) const {
+   const line& ln = e->at(n);
+   coord_t s0 = ln.get_S0();
+   coord_t s1 = ln.get_S1();
+
+   for (size_t dir = LEFT; dir <= DOWN; dir++) {
+      // Select the important axis
+      double S0 = ((dir == UP) || (dir == DOWN)) ? s0.y : s0.x;
+      double S1 = ((dir == UP) || (dir == DOWN)) ? s1.y : s1.x;
+
+      // Test if this line improves the estimate
+      if (test_extremity((direction_e)dir, S0, &bb.ext[dir], &bb.ptu[dir], &bb.ptd[dir], s0))
+         bb.elm[dir] = n;
+      if (test_extremity((direction_e)dir, S1, &bb.ext[dir], &bb.ptu[dir], &bb.ptd[dir], s1))
+         bb.elm[dir] = n;
+   }
 }
 
 // ADD NEW ELEMENT
 line_iter obj::add(coord_t s0, coord_t s1) // Initialise using two points
 {
-   e.emplace_back(s0, s1);
-   return last();
+   return add(line(s0, s1));
 }
 
 line_iter obj::add(coord_t s0, vector_t v0) // Initialise using point and a vector
 {
-   e.emplace_back(s0, v0);
-   return last();
+   return add(line(s0, v0));
 }
 
 line_iter obj::add(const line& ln) // Initialise using two points
 {
-   e.emplace_back(ln);
-   return last();
+   uint32_t n = e->insert(line_store::HEAD, ln);
+   ix_invalidate();
+
+   // Elements are appended, so the bounding box can be extended in the same order find_extremity() visits them
+   if (e->size() == 1)
+      bb_reset();
+   if (bb.valid)
+      bb_include(n);
+   return line_iter(e.get(), n);
 }
 
 line_iter obj::add(double x1, double y1, double x2, double y2) {
@@ -560,7 +1551,7 @@ void obj::add_dotted(const line& ln, double marklen, double splen) {
    double markT = (marklen / ln.len());
    double spaceT = (splen / ln.len());
    for (double T = 0.0; T <= (1.0 - markT); T = T + (markT + spaceT)) {
-      e.emplace_back(ln.get_pt(T), ln.get_pt(T + markT));
+      add(ln.get_pt(T), ln.get_pt(T + markT));
    }
 }
 
@@ -619,70 +1610,97 @@ void obj::add_ellipse(coord_t centre, double rx, double ry) {
 }
 
 void obj::move_back_to_front() {
-   if (!e.empty()) {
-      line ln = *(std::prev(e.end()));
-      e.pop_back();
-      e.emplace_front(ln);
+   if (!empty()) {
+      e->move(e->first(), e->last());
+      bb.valid = false;
+      ix_invalidate();
    }
 }
 
+void obj::set(line_iter ln, coord_t s0, coord_t s1) {
+   ref(ln).set(s0, s1);
+}
+
 // DELETE
 void obj::del(line_iter& iter) {
    if (iter == end())
       FATAL("Cannot delete when iterator = end()");
 
-   e.erase(iter);
+   // Taking elements away cannot make duplicates
+   uint8_t keep = ix.norm & NORM_COMPACT;
+   ref(iter);
+   e->erase(iter.n);
+   ix.norm |= keep;
 }
 
 void obj::del(line_iter& first, line_iter& last) {
    if (first == end())
       FATAL("Cannot delete when iterator = end()");
 
-   e.erase(first, last);
+   for (line_iter ln = first; ln != last;) {
+      line_iter nxt = next(ln);
+      del(ln);
+      ln = nxt;
+   }
 }
 
 void obj::del() {
-   e.clear();
+   e->clear();
+   bb.valid = false;
+   ix_invalidate();
 }
 
-size_t obj::del_duplicates() {
-   size_t cnt = 0;
-
-   for (auto cur = begin(); cur != end(); ++cur) // Loop all iterators
-   {
-      for (auto cmp = next(cur); cmp != end(); ++cmp) // Loop through elements in front of cur
-      {
-         if (cur->is_same_as(*cmp)) {
-            del(cmp);
-            cmp = cur;
-            cnt++;
-         }
-      }
-   }
-   return cnt;
+// Key for finding identical elements, made from the bit patterns of the values line::is_same_as() compares exactly;
+// adding 0.0 turns -0.0 into 0.0, the one pair of different patterns that compare equal
+static uint64_t elementKey(const line& ln) {
+   uint64_t k = 0;
+   for (double v : { ln.get_S0().x, ln.get_S0().y, ln.get_V().dx, ln.get_V().dy })
+      k = (k * 0x9E3779B97F4A7C15ull) ^ std::bit_cast<uint64_t>(v + 0.0);
+   return k;
 }
 
-size_t obj::del_zero_lens() {
-   auto ln = begin();
+size_t obj::del_matching(bool dupes, bool zeros) {
+   if (ix.norm & NORM_COMPACT)
+      return 0;
+
    size_t cnt = 0;
+   std::unordered_multimap<uint64_t, uint32_t> kept;
+   if (dupes)
+      kept.reserve(size());
 
-   while (ln != end()) {
-      if (ln->len() < SMALL_NUM) {
+   for (line_iter ln = begin(); ln != end();) {
+      line_iter nxt = next(ln);
+      bool drop = zeros && (ln->len() < SMALL_NUM);
+      if (!drop && dupes) {
+         // Keep the first of any identical elements
+         uint64_t k = elementKey(*ln);
+         auto [from, to] = kept.equal_range(k);
+         for (auto it = from; (it != to) && !drop; ++it)
+            drop = e->at(it->second).is_same_as(*ln);
+         if (!drop)
+            kept.emplace(k, ln.n);
+      }
+      if (drop) {
          del(ln);
-         ln = begin();
          cnt++;
       }
-      else {
-         ++ln;
-      }
+      ln = nxt;
    }
+   if (dupes && zeros)
+      ix.norm |= NORM_COMPACT;
    return cnt;
 }
 
-bool obj::del_dupes_zeros() {
-   size_t d = del_duplicates();
-   size_t z = del_zero_lens();
-   return ((d != 0) || (z != 0));
+size_t obj::del_duplicates() {
+   return del_matching(true, false);
+}
+
+size_t obj::del_zero_lens() {
+   return del_matching(false, true);
+}
+
+size_t obj::compact() {
+   return del_matching(true, true);
 }
 
 size_t obj::remove_verticals() {
@@ -702,52 +1720,48 @@ size_t obj::remove_verticals() {
 // POSITIONAL
 line_iter obj::begin() const // First Element iterator
 {
-   return e.begin();
+   return line_iter(e.get(), e->first());
 }
 
 line_iter obj::last() const // Last element iterator
 {
-   if (e.empty())
-      return e.end();
-   return std::prev(e.end());
+   return line_iter(e.get(), e->last());
 }
 
 line_iter obj::end() const // End element iterator
 {
-   return e.end();
+   return line_iter(e.get(), line_store::HEAD);
 }
 
 const_line_iter obj::cbegin() const // First Element iterator
 {
-   return e.cbegin();
+   return begin();
 }
 
 const_line_iter obj::clast() const // Last element iterator
 
 {
-   if (e.empty())
-      return e.cend();
-   return std::prev(e.cend());
+   return last();
 }
 
 const_line_iter obj::cend() const // End element iterator
 {
-   return e.cend();
+   return end();
 }
 
 bool obj::is_begin(line_iter ln) const {
-   return (ln == e.begin());
+   return (ln == begin());
 }
 
 bool obj::is_last(line_iter ln) const {
-   if (ln == e.end())
+   if (ln == end())
       return false;
    ++ln;
-   return (ln == e.end());
+   return (ln == end());
 }
 
 bool obj::is_end(line_iter ln) const {
-   return (ln == e.end());
+   return (ln == end());
 }
 
 line_iter obj::nextc(line_iter ln) const {
@@ -784,10 +1798,14 @@ line_iter obj::prev(line_iter ln) const {
 
 // INTERROGATION
 bool obj::empty() const {
-   return e.empty();
+   return (e->size() == 0);
 }
 
 double obj::len() const {
+   // The running length table holds the same sum, if it has been built
+   if (!ix.lengths.empty())
+      return ix.lengths.back().start + ix.lengths.back().len;
+
    double l = 0.0;
    for (line_iter ln = begin(); ln != end(); ++ln) {
       l += ln->len();
@@ -796,7 +1814,7 @@ double obj::len() const {
 }
 
 size_t obj::size() const {
-   return e.size();
+   return e->size();
 }
 
 coord_t obj::get_sp() const // Get the first point of the first element
@@ -822,18 +1840,69 @@ coord_t obj::get_pt_along_length(double dist, line_iter& ln, double& T) const {
       return get_sp();
    }
 
-   dist = std::fmod(dist, len()); // Continue around the object if dist > object length
-   double lenSoFar = 0.0;
-   for (ln = begin(); ln != end(); ++ln) {
-      double llen = ln->len();
-      T = (dist - lenSoFar) / llen;
-      if (T <= T_S1)
-         return ln->get_pt(T);
-      else
-         lenSoFar += llen;
+   // Binary search the running lengths for the element ending at dist, then settle on the first element that passes
+   // the same test a walk along the elements would make
+   const std::vector<length_step>& lt = length_table();
+   dist = std::fmod(dist, lt.back().start + lt.back().len); // Continue around the object if dist > object length
+   size_t k = std::lower_bound(lt.begin(), lt.end(), dist, [](const length_step& st, double d) {
+      return (st.start + st.len) < d;
+   }) - lt.begin();
+   while ((k > 0) && (((dist - lt[k - 1].start) / lt[k - 1].len) <= T_S1))
+      k--;
+   while ((k < lt.size()) && !(((dist - lt[k].start) / lt[k].len) <= T_S1))
+      k++;
+   if (k == lt.size()) {
+      dbg::fatal(SS("Internal error in get_pt_along_length"), TS(dist));
+      return coord_t{ 0.0, 0.0 };
+   }
+
+   T = (dist - lt[k].start) / lt[k].len;
+   ln = line_iter(e.get(), lt[k].n);
+   return ln->get_pt(T);
+}
+
+size_t obj::get_pts_along_length(double start, double spacing, size_t n, std::vector<coord_t>& pts,
+   std::vector<line_iter>* lns) const {
+   pts.clear();
+   if (lns)
+      lns->clear();
+   if (empty())
+      return 0;
+   pts.reserve(n);
+   if (lns)
+      lns->reserve(n);
+
+   // Walk along the running lengths, only going back to the first element when the distance wraps around the object,
+   // placing each point exactly where get_pt_along_length() would
+   const std::vector<length_step>& lt = length_table();
+   const double total = lt.back().start + lt.back().len;
+   double prev = 0.0;
+   size_t k = 0;
+   for (size_t i = 0; i < n; i++) {
+      double dist = start + (i * spacing);
+      if (dist <= 0.0) {
+         pts.push_back(get_sp());
+         if (lns)
+            lns->push_back(begin());
+         continue;
+      }
+
+      dist = std::fmod(dist, total);
+      if (dist < prev)
+         k = 0;
+      prev = dist;
+      while ((k < lt.size()) && !(((dist - lt[k].start) / lt[k].len) <= T_S1))
+         k++;
+      if (k == lt.size()) {
+         dbg::fatal(SS("Internal error in get_pts_along_length"), TS(dist));
+         return pts.size();
+      }
+
+      pts.push_back(e->at(lt[k].n).get_pt((dist - lt[k].start) / lt[k].len));
+      if (lns)
+         lns->push_back(line_iter(e.get(), lt[k].n));
    }
-   dbg::fatal(SS("Internal error in get_pt_along_length"), TS(lenSoFar));
-   return coord_t{ 0.0, 0.0 };
+   return pts.size();
 }
 
 coord_t obj::get_pt_along_length(double dist, line_iter& ln) const {
@@ -848,7 +1917,7 @@ coord_t obj::get_pt_along_length(double dist) const {
 }
 
 size_t obj::index(line_iter ln) const {
-   return std::distance(begin(), ln);
+   return e->position(ln.n);
 }
 
 bool obj::sX_is_at(coord_t pt, line_iter& ln, double T) const {
@@ -920,10 +1989,10 @@ bool obj::findMarkerSquare(double size, coord_t* centre, bool deleteIt) {
          PR_ANY("Marker (%.2lf x %.2lf) found at x=%lf y=%lf\n", size, size, centre->x, centre->y);
 
          if (deleteIt) {
-            e.erase(sq[0]);
-            e.erase(sq[1]);
-            e.erase(sq[2]);
-            e.erase(sq[3]);
+            del(sq[0]);
+            del(sq[1]);
+            del(sq[2]);
+            del(sq[3]);
             PR_ANY("Marker deleted\n");
          }
          return (true);
@@ -947,6 +2016,21 @@ line_iter obj::line_intersect(const line& l2, coord_t* i, int allowExtrapolation
 }
 
 line_iter obj::line_intersect(line_iter l1, const line& l2, coord_t* i, int allowExtrapolation) const {
+   // With extrapolation every non-parallel element intersects, so only a plain search can be indexed
+   const line_index* idx = allowExtrapolation ? nullptr : indexed(1);
+   if (idx && (l1 != end())) {
+      std::vector<uint32_t> cand;
+      index_candidates(l2, idx, cand);
+      size_t from = e->position(l1.n);
+      for (uint32_t n : cand) {
+         if ((e->position(n) >= from) && e->at(n).lines_intersect(l2, i, 0))
+            return line_iter(e.get(), n);
+      }
+      if (i)
+         *i = coord_t{ 0.0, 0.0 };
+      return end();
+   }
+
    while (l1 != end()) {
       if (l1->lines_intersect(l2, i, allowExtrapolation)) {
          break;
@@ -956,35 +2040,39 @@ line_iter obj::line_intersect(line_iter l1, const line& l2, coord_t* i, int allo
    return l1;
 }
 
-bool obj::line_intersect(line l2, std::list<obj_line_intersect>* isects, int allowExtrapolation) const {
+bool obj::line_intersect(line l2, std::pmr::list<obj_line_intersect>* isects, int allowExtrapolation) const {
    coord_t iPt = {};
    bool retval = false;
 
-   if (allowExtrapolation) {
-      // Extrapolation refers to L2, not the line elements of the object
-      // So we fudge it by extending the line L2 outside of the object extremities
-      // Find the extremities of this object
-      double ext[4];
-      find_extremity(ext);
-
-      // Keep expanding the line until both ends are outside of the bounding box of the object
-      bool finished = false;
-      do {
-         coord_t S0 = l2.get_pt(-1.0);
-         coord_t S1 = l2.get_pt(+2.0);
-         l2.set(S0, S1);
-         bool xOk = ((S0.x < ext[LEFT]) && (S1.x > ext[RIGHT])) || ((S1.x < ext[LEFT]) && (S0.x > ext[RIGHT]));
-         bool yOk = ((S0.y < ext[DOWN]) && (S1.y > ext[UP])) || ((S1.y < ext[DOWN]) && (S0.y > ext[UP]));
-         finished = xOk || yOk;
-      } while (!finished);
-   }
-
-   // Work through the object elements and find all the intersections with L2
-   for (line_iter ln = begin(); ln != end(); ++ln) {
-      if (ln->lines_intersect(l2, &iPt, 0)) {
+   // Extrapolation refers to L2, not the line elements of the object
+   // So we fudge it by extending the line L2 outside of the object extremities
+   if (allowExtrapolation)
+      l2 = extrapolate_across(l2);
+
+   // Work through the object elements, or just the ones the index says L2 passes near, and test them as a batch
+   std::vector<uint32_t> cand;
+   const line_index* idx = indexed(1);
+   if (idx)
+      index_candidates(l2, idx, cand);
+   else
+      for (line_iter ln = begin(); ln != end(); ++ln)
+         cand.push_back(ln.n);
+
+   std::pmr::vector<uint8_t> res(cand.size());
+   std::pmr::vector<double> t(cand.size());
+   batched().intersect_listed(l2, false, cand.data(), cand.size(), res.data(), t.data());
+
+   for (size_t k = 0; k < cand.size(); k++) {
+      const line& ln = e->at(cand[k]);
+      bool hit = (res[k] == segment_batch::HIT);
+      if (hit)
+         iPt = ln.get_pt(t[k]);
+      else if (res[k] == segment_batch::PARALLEL)
+         hit = ln.lines_intersect(l2, &iPt, 0);
+      if (hit) {
          retval = true;
          if (isects) {
-            obj_line_intersect intersect = { l2.T_for_pt(iPt), ln, iPt };
+            obj_line_intersect intersect = { l2.T_for_pt(iPt), line_iter(e.get(), cand[k]), iPt };
             isects->push_back(intersect);
          }
       }
@@ -997,33 +2085,162 @@ bool obj::line_intersect(line l2, std::list<obj_line_intersect>* isects, int all
    return (retval);
 }
 
+line obj::extrapolate_across(line l2) const {
+   // Find the extremities of this object
+   double ext[4];
+   find_extremity(ext);
+
+   // Keep expanding the line until both ends are outside of the bounding box of the object
+   bool finished = false;
+   do {
+      coord_t S0 = l2.get_pt(-1.0);
+      coord_t S1 = l2.get_pt(+2.0);
+      l2.set(S0, S1);
+      bool xOk = ((S0.x < ext[LEFT]) && (S1.x > ext[RIGHT])) || ((S1.x < ext[LEFT]) && (S0.x > ext[RIGHT]));
+      bool yOk = ((S0.y < ext[DOWN]) && (S1.y > ext[UP])) || ((S1.y < ext[DOWN]) && (S0.y > ext[UP]));
+      finished = xOk || yOk;
+   } while (!finished);
+   return l2;
+}
+
 bool obj::obj_intersect(obj& o) const {
-   coord_t temp;
-   for (line_iter ln = o.begin(); ln != o.end(); ++ln) {
-      if (line_intersect(*ln, &temp, 0) != end())
-         return true;
-   }
-   return false;
+   // Sweep both objects together and stop at the first crossing between them
+   segment_sweep sw;
+   sw.reserve(size() + o.size());
+   for (line_iter ln = begin(); ln != end(); ++ln)
+      sw.add(*ln, 0);
+   for (line_iter ln = o.begin(); ln != o.end(); ++ln)
+      sw.add(*ln, 1);
+
+   std::vector<segment_sweep::crossing> xs;
+   return (sw.crossings(xs, true, 1) != 0);
 }
 
 bool obj::top_bot_intersect(double xpos, coord_t* upper, coord_t* lower, line_iter& it_upper, line_iter& it_lower) const {
-   std::list<obj_line_intersect> isects = {};
-   line ref(coord_t{ xpos, 0.0 }, coord_t{ xpos, 1.0 });
+   if (empty())
+      return false;
+
+   // Same vertical line as line_intersect() would extrapolate, so the same elements are found
+   line ref = extrapolate_across(line(coord_t{ xpos, 0.0 }, coord_t{ xpos, 1.0 }));
 
-   line_intersect(ref, &isects, 1);
+   // Only the elements spanning xpos can be hit; use the slab index to find them if there is one
+   const uint32_t* cand = nullptr;
+   size_t ncand = 0;
+   const x_slab_index* idx = slab_indexed();
+   if (idx)
+      ncand = idx->candidates(xpos, &cand);
 
-   if (isects.size() == 0)
+   tb_state st;
+   if (idx) {
+      for (size_t k = 0; k < ncand; k++)
+         tb_test(ref, cand[k], true, st);
+   }
+   else {
+      for (uint32_t n = e->first(); n != line_store::HEAD; n = e->next(n))
+         tb_test(ref, n, false, st);
+   }
+
+   if (!st.found)
       return false;
 
-   *lower = isects.front().pt;
-   it_lower = isects.front().ln;
+   *lower = st.plo;
+   it_lower = line_iter(e.get(), st.nlo);
 
-   *upper = isects.back().pt;
-   it_upper = isects.back().ln;
+   *upper = st.phi;
+   it_upper = line_iter(e.get(), st.nhi);
 
    return true;
 }
 
+size_t obj::top_bot_intersect(const std::vector<double>& xpos, std::vector<obj_vert_intersect>& res) const {
+   res.assign(xpos.size(), obj_vert_intersect{});
+   if (empty())
+      return 0;
+   for (size_t k = 1; k < xpos.size(); k++)
+      if (xpos[k] < xpos[k - 1])
+         FATAL("x positions must be in increasing order");
+
+   // Padded x extent of every element, in order of the left end.  The working vectors draw from the geometry arena
+   // during a Wing build and from the heap otherwise, as for the neutral point calculation.
+   struct span {
+      double lo, hi;
+      uint32_t n;
+   };
+   std::pmr::vector<span> spans;
+   spans.reserve(size());
+   for (uint32_t n = e->first(); n != line_store::HEAD; n = e->next(n)) {
+      double x0 = e->at(n).get_S0().x;
+      double x1 = e->at(n).get_S1().x;
+      spans.push_back(span{ std::min(x0, x1) - INDEX_PAD, std::max(x0, x1) + INDEX_PAD, n });
+   }
+   std::sort(spans.begin(), spans.end(), [](const span& a, const span& b) { return a.lo < b.lo; });
+
+   // Sweep across, keeping the set of elements that span the current x
+   std::pmr::vector<span> active;
+   size_t nxt = 0, found = 0;
+   for (size_t k = 0; k < xpos.size(); k++) {
+      double x = xpos[k];
+      if ((k > 0) && (x == xpos[k - 1])) {
+         // Repeated x, e.g. along a rib square to the span, gives the same answer
+         res[k] = res[k - 1];
+         found += res[k].found ? 1 : 0;
+         continue;
+      }
+      while ((nxt < spans.size()) && (spans[nxt].lo <= x))
+         active.push_back(spans[nxt++]);
+      for (size_t a = 0; a < active.size();) {
+         if (active[a].hi < x) {
+            active[a] = active.back();
+            active.pop_back();
+         }
+         else
+            a++;
+      }
+
+      // Same test as a single query, so the results match it exactly
+      line ref = extrapolate_across(line(coord_t{ x, 0.0 }, coord_t{ x, 1.0 }));
+      tb_state st;
+      for (const span& a : active)
+         tb_test(ref, a.n, true, st);
+
+      if (st.found) {
+         res[k].found = true;
+         res[k].lower = st.plo;
+         res[k].it_lower = line_iter(e.get(), st.nlo);
+         res[k].upper = st.phi;
+         res[k].it_upper = line_iter(e.get(), st.nhi);
+         found++;
+      }
+   }
+   return found;
+}
+
+void obj::tb_test(const line& ref, uint32_t n, bool byPosition, tb_state& st) const {
+   coord_t iPt;
+   if (!e->at(n).lines_intersect(ref, &iPt, 0))
+      return;
+   double T = ref.T_for_pt(iPt);
+   if (!st.found) {
+      st.tlo = st.thi = T;
+      st.nlo = st.nhi = n;
+      st.plo = st.phi = iPt;
+      st.found = true;
+      return;
+   }
+
+   // Equal hits resolve in path order, as a stable sort by T would
+   if ((T < st.tlo) || ((T == st.tlo) && byPosition && (e->position(n) < e->position(st.nlo)))) {
+      st.tlo = T;
+      st.nlo = n;
+      st.plo = iPt;
+   }
+   if ((T > st.thi) || ((T == st.thi) && (!byPosition || (e->position(n) > e->position(st.nhi))))) {
+      st.thi = T;
+      st.nhi = n;
+      st.phi = iPt;
+   }
+}
+
 bool obj::top_bot_intersect(double xpos, coord_t* upper, coord_t* lower) const {
    line_iter ln0, ln1;
    return top_bot_intersect(xpos, upper, lower, ln0, ln1);
@@ -1094,35 +2311,21 @@ void obj::find_extremity(coord_t pt[4], double extremity[4], line_iter elm[4]) c
       }
       return;
    }
-   coord_t ptu[4] = { 0, 0 }, ptd[4] = { 0, 0 };
-
-   // Initialise best extremity estimate so far
-   extremity[LEFT] = extremity[DOWN] = HUGE;
-   extremity[RIGHT] = extremity[UP] = -HUGE;
-
-   // Work through all the elements to find the extremity
-   line_iter ln = begin();
-   while (ln != end()) {
-      for (size_t dir = LEFT; dir <= DOWN; dir++) {
-         // Select the important axis
-         double S0 = ((dir == UP) || (dir == DOWN)) ? ln->get_S0().y : ln->get_S0().x;
-         double S1 = ((dir == UP) || (dir == DOWN)) ? ln->get_S1().y : ln->get_S1().x;
-
-         // Test if this line immproves the estimate
-         if (test_extremity((direction_e)dir, S0, &extremity[dir], &ptu[dir], &ptd[dir], ln->get_S0()))
-            elm[dir] = ln;
-         if (test_extremity((direction_e)dir, S1, &extremity[dir], &ptu[dir], &ptd[dir], ln->get_S1()))
-            elm[dir] = ln;
-      }
-      ++ln;
+   // Work through all the elements to find the extremity, unless the cached bounding box is still good
+   if (!bb.valid) {
+      bb_reset();
+      for (uint32_t n = e->first(); n != line_store::HEAD; n = e->next(n))
+         bb_include(n);
+      PR_ANY("\n");
    }
 
    // Actual extremity is halfway between ptu and ptd
    for (size_t dir = LEFT; dir <= DOWN; dir++) {
-      line temp(ptu[dir], ptd[dir]);
+      line temp(bb.ptu[dir], bb.ptd[dir]);
       pt[dir] = temp.get_pt(0.5);
+      extremity[dir] = bb.ext[dir];
+      elm[dir] = line_iter(e.get(), bb.elm[dir]);
    }
-   PR_ANY("\n");
 }
 
 double obj::find_extremity(direction_e dir) const {
@@ -1147,14 +2350,31 @@ void obj::find_extremity(double val[4]) const {
 }
 
 bool obj::surrounds_point(coord_t pt) {
-   line testLn = { pt, vector_t{LARGE, LARGE} };
+   line testLn = { pt, vector_t{ LARGE, 0.0 } };
    size_t crossings = 0;
 
-   // Count the number of times a line from the point crosses this object
-   for (line_iter ln = begin(); ln != end(); ++ln) {
-      coord_t dummy = {};
-      if (testLn.lines_intersect(*ln, &dummy, 0))
-         ++crossings;
+   // Count the elements crossing a line from the point in +x.  Each element spans the half-open band of y above its
+   // lower end, so a line through a vertex counts it once, and which side of the element the point is on is exact.
+   auto crosses = [&pt](const line& ln) {
+      coord_t a = ln.get_S0();
+      coord_t b = ln.get_S1();
+      if ((a.y > pt.y) == (b.y > pt.y))
+         return false;
+      double o = orient2d(a, b, pt);
+      return (b.y > a.y) ? (o > 0.0) : (o < 0.0);
+   };
+   const line_index* idx = indexed(1);
+   if (idx) {
+      std::vector<uint32_t> cand;
+      idx->candidates(testLn, cand);
+      for (uint32_t n : cand)
+         if (crosses(e->at(n)))
+            ++crossings;
+   }
+   else {
+      for (line_iter ln = begin(); ln != end(); ++ln)
+         if (crosses(*ln))
+            ++crossings;
    }
 
    // Point is surrounded if we have an odd number of crossings
@@ -1174,7 +2394,7 @@ void obj::split_along_line(
    const line ln,
    obj& left,
    obj& right,
-   std::list<obj_line_intersect>* isects) {
+   std::pmr::list<obj_line_intersect>* isects) {
    // Create a copy and rotate it so that the split-line would be horizontal
    obj ref = {};
    ref.copy_from(*this);
@@ -1242,8 +2462,8 @@ void obj::split_along_line_rejoin(
    const line ln,
    obj& left,
    obj& right,
-   std::list<obj_line_intersect>* isects) {
-   std::list<obj_line_intersect> localIsects = {};
+   std::pmr::list<obj_line_intersect>* isects) {
+   std::pmr::list<obj_line_intersect> localIsects = {};
    if (!isects)
       isects = &localIsects;
 
@@ -1253,8 +2473,8 @@ void obj::split_along_line_rejoin(
    // Assumes that the split ends should be joined in sequence
    // 0 to 1, 2 to 3 etc.
    for (int i = 1; i < (int)isects->size(); i = i + 2) {
-      std::list<obj_line_intersect>::iterator is_a = isects->begin();
-      std::list<obj_line_intersect>::iterator is_b = isects->begin();
+      std::pmr::list<obj_line_intersect>::iterator is_a = isects->begin();
+      std::pmr::list<obj_line_intersect>::iterator is_b = isects->begin();
       std::advance(is_a, i - 1);
       std::advance(is_b, i);
       left.add(is_a->pt, is_b->pt);
@@ -1269,7 +2489,7 @@ bool obj::remove_extremity(double pos, direction_e dir, coord_t* ptu, coord_t* p
    line ln = {};
    obj left = {};
    obj right = {};
-   std::list<obj_line_intersect> isects = {};
+   std::pmr::list<obj_line_intersect> isects = {};
 
    switch (dir) {
    case LEFT:
@@ -1318,41 +2538,78 @@ bool obj::remove_extremity_rejoin(double pos, direction_e dir) {
    return remove_extremity(pos, dir, &t1, &t2, true);
 }
 
+void obj::transform(const affine_t& m) {
+   e->transform(m);
+   bb.valid = false;
+   ix_invalidate();
+}
+
 void obj::add_offset(double xOffset, double yOffset) {
-   for (line_iter ln = begin(); ln != end(); ++ln) {
-      ln->add_offset(xOffset, yOffset);
+   // A shift keeps the paths, their winding and the spacing of the elements
+   e->transform(affine_t::translate(xOffset, yOffset));
+   ix_invalidate(NORM_ALL);
+
+   // A shift moves the bounding box with the elements
+   if (bb.valid) {
+      bb.ext[LEFT] += xOffset;
+      bb.ext[RIGHT] += xOffset;
+      bb.ext[UP] += yOffset;
+      bb.ext[DOWN] += yOffset;
+      for (size_t dir = LEFT; dir <= DOWN; dir++) {
+         bb.ptu[dir] = coord_t{ bb.ptu[dir].x + xOffset, bb.ptu[dir].y + yOffset };
+         bb.ptd[dir] = coord_t{ bb.ptd[dir].x + xOffset, bb.ptd[dir].y + yOffset };
+      }
    }
 }
 
 void obj::splice(line_iter pos_in_o, obj& o) {
-   e.splice(end(), o.e, pos_in_o);
+   add(*pos_in_o);
+   o.del(pos_in_o);
 }
 
 void obj::splice(obj& o) {
-   e.splice(end(), o.e);
+   // Nothing here yet, so just take over o's elements
+   if (empty()) {
+      e.swap(o.e);
+      std::swap(bb, o.bb);
+      std::swap(ix, o.ix);
+      return;
+   }
+
+   copy_from(o);
+   o.del();
 }
 
 void obj::copy_from(obj& o) {
-   obj dup = { o };
-   e.splice(e.end(), dup.e);
+   // Nothing here yet, so share o's elements until one of us changes them
+   if (empty()) {
+      if (this != &o) {
+         *e = *o.e;
+         bb = o.bb;
+         ix_invalidate();
+         ix_copy_norm(o);
+      }
+      return;
+   }
+
+   // Count first as o may be this object
+   size_t n = o.size();
+   e->reserve(size() + n);
+   line_iter ln = o.begin();
+   for (size_t k = 0; k < n; ++k, ++ln)
+      add(*ln);
 }
 
 void obj::rotate(coord_t pivot, double rads) {
-   for (line_iter ln = begin(); ln != end(); ++ln) {
-      ln->rotate(pivot, rads);
-   }
+   transform(affine_t::rotate(pivot, rads));
 }
 
 void obj::mirror_x() {
-   for (line_iter ln = begin(); ln != end(); ++ln) {
-      ln->mirror_x();
-   }
+   transform(affine_t::scale(-1.0, 1.0));
 }
 
 void obj::mirror_y() {
-   for (line_iter ln = begin(); ln != end(); ++ln) {
-      ln->mirror_y();
-   }
+   transform(affine_t::scale(1.0, -1.0));
 }
 
 void obj::make_path() {
@@ -1373,11 +2630,40 @@ void obj::make_path(double snaplen, std::list<obj>& closed, std::list<obj>& open
 void obj::make_path(double snaplen, std::list<obj>& closed, std::list<obj>& open, bool listPaths, bool keepOpens) {
    PR_ANY("make_path: listPaths %u  keepOpens %u", listPaths, keepOpens);
 
+   // If the elements have not changed since they were last sorted into paths with this snap length, and there are no
+   // open paths to delete, they are already in order
+   bool current = (ix.norm & NORM_PATHS) && (ix.pathSnap == snaplen);
+   for (size_t p = 0; current && !keepOpens && (p < ix.paths.size()); p++)
+      current = ix.paths[p].closed;
+   if (current) {
+      PR_ANY(": unchanged, %zu paths\n", ix.paths.size());
+      if (listPaths) {
+         for (const path_info& pi : ix.paths) {
+            obj dwg;
+            line_iter ln(e.get(), pi.first);
+            for (uint32_t k = 0; k < pi.count; k++, ++ln)
+               dwg.add(*ln);
+
+            if (pi.closed)
+               closed.emplace_back(dwg);
+            else
+               open.emplace_back(dwg);
+         }
+      }
+      return;
+   }
+
+   // Larger objects find each next element through a grid of element ends rather than a scan
+   std::unique_ptr<path_joiner> pj;
+   if (size() >= INDEX_MIN_ELEMENTS)
+      pj = std::make_unique<path_joiner>();
+
+   std::vector<path_info> found;
    line_iter st = begin();
    line_iter en;
    while (st != end()) {
       // Get the next path, open or closed
-      bool isClosed = trace_a_path(snaplen, st, en);
+      bool isClosed = trace_a_path(snaplen, st, en, pj.get());
 
       PR_ANY(": isClosed %u  Size %zu  St %zu  En+1 %zu", isClosed, size(), index(st), index(en));
 
@@ -1391,10 +2677,20 @@ void obj::make_path(double snaplen, std::list<obj>& closed, std::list<obj>& open
          if (isClosed) {
             if (!is_clockwise(st, en)) {
                PR_ANY(": Reversing");
-               for (line_iter ln = st; ln != en; ++ln)
-                  ln->reverse();
+               size_t was = 0;
+               for (line_iter ln = st; ln != en; ++ln, was++)
+                  ref(ln).reverse();
                if (!trace_a_path(snaplen, st, en))
                   FATAL("Error: Unable to make a closed path after reversing elements");
+
+               // If that left elements behind or took in new ones the grid no longer fits the rest, so rebuild it
+               if (pj && pj->ready) {
+                  size_t same = 0;
+                  for (line_iter ln = st; ln != en; ++ln)
+                     same += pj->used[ln.n] ? 1 : 0;
+                  if ((same != was) || (same != (size_t)std::distance(st, en)))
+                     pj->ready = false;
+               }
             }
          }
 
@@ -1409,13 +2705,19 @@ void obj::make_path(double snaplen, std::list<obj>& closed, std::list<obj>& open
             else
                open.emplace_back(dwg);
          }
+         found.push_back(path_info{ st.n, (uint32_t)std::distance(st, en), isClosed });
       }
       st = en;
    }
+
+   // Sorting edits the elements, which clears the paths, so record them now it is done
+   ix.paths = std::move(found);
+   ix.pathSnap = snaplen;
+   ix.norm |= NORM_PATHS;
    PR_ANY("\n");
 }
 
-bool obj::trace_a_path(double snaplen, line_iter& st, line_iter& en) {
+bool obj::trace_a_path(double snaplen, line_iter& st, line_iter& en, path_joiner* pj) {
    mpState_e state = MP_INIT;
    line_iter nx;
 
@@ -1424,12 +2726,50 @@ bool obj::trace_a_path(double snaplen, line_iter& st, line_iter& en) {
       case MP_INIT:
          en = st;
          nx = st;
+         if (pj && pj->ready && !is_end(st))
+            pj->used[st.n] = 1;
          // If empty object, return open path with both iterators -> end()
          state = (is_end(st)) ? MP_PATH_OPEN : MP_PROCESS_PATH;
          break;
 
       case MP_PROCESS_PATH:
-         nx = next(nx);
+         if (pj) {
+            // A scan would take the first remaining element that has an end near either end of the path.  That
+            // is usually the one straight after the path, otherwise look for the earliest in the grid
+            coord_t pe = en->get_S1();
+            coord_t ps = st->get_S0();
+            auto touches = [pe, ps, snaplen](const line& l) {
+               return (distTwoPoints(pe, l.get_S1()) <= snaplen) || (distTwoPoints(pe, l.get_S0()) <= snaplen) ||
+                  (distTwoPoints(ps, l.get_S0()) <= snaplen) || (distTwoPoints(ps, l.get_S1()) <= snaplen);
+            };
+            nx = next(en);
+            if (!is_end(nx) && !touches(*nx)) {
+               if (!pj->ready) {
+                  pj->grid.build(*e, nx.n, snaplen);
+                  pj->rank.assign(e->pool_size(), 0);
+                  pj->used.assign(e->pool_size(), 1);
+                  uint32_t r = 0;
+                  for (uint32_t n = nx.n; n != line_store::HEAD; n = e->next(n)) {
+                     pj->used[n] = 0;
+                     pj->rank[n] = r++;
+                  }
+                  pj->ready = true;
+               }
+               pj->cand.clear();
+               pj->grid.near(pe, pj->cand);
+               pj->grid.near(ps, pj->cand);
+               uint32_t best = line_store::HEAD;
+               for (uint32_t n : pj->cand) {
+                  if (!pj->used[n] && ((best == line_store::HEAD) || (pj->rank[n] < pj->rank[best])) && touches(e->at(n)))
+                     best = n;
+               }
+               nx = line_iter(e.get(), best);
+            }
+            if (pj->ready && !is_end(nx))
+               pj->used[nx.n] = 1;
+         }
+         else
+            nx = next(nx);
 
          // If no more elements in object, path must be open
          if (is_end(nx)) {
@@ -1439,19 +2779,19 @@ bool obj::trace_a_path(double snaplen, line_iter& st, line_iter& en) {
 
          // Is it connected to the end of the path but reversed?
          if (distTwoPoints(en->get_S1(), nx->get_S1()) <= snaplen) {
-            nx->reverse();
+            ref(nx).reverse();
          }
 
          // Is it correctly connected to the end of the path?
          if (distTwoPoints(en->get_S1(), nx->get_S0()) <= snaplen) {
             // Snap its S0 to the line end and splice it onto the path end
-            nx->set(en->get_S1(), nx->get_S1());
-            e.splice(next(en), e, nx);
+            ref(nx).set(en->get_S1(), nx->get_S1());
+            e->move(next(en).n, nx.n);
 
             // Does it close the path?
             if (distTwoPoints(st->get_S0(), nx->get_S1()) <= snaplen) {
                // Snap its S1 to the line start and finish as closed
-               nx->set(nx->get_S0(), st->get_S0());
+               ref(nx).set(nx->get_S0(), st->get_S0());
                state = MP_PATH_CLOSED;
             }
             en = nx;
@@ -1460,14 +2800,14 @@ bool obj::trace_a_path(double snaplen, line_iter& st, line_iter& en) {
 
          // Is it connected to the start of the path but reversed?
          if (distTwoPoints(st->get_S0(), nx->get_S0()) <= snaplen) {
-            nx->reverse();
+            ref(nx).reverse();
          }
 
          // Is it connected to the start of the path?
          if (distTwoPoints(st->get_S0(), nx->get_S1()) <= snaplen) {
             // Snap its S1 to the line start and move it to ahead of the path
-            nx->set(nx->get_S0(), st->get_S0());
-            e.splice(st, e, nx);
+            ref(nx).set(nx->get_S0(), st->get_S0());
+            e->move(st.n, nx.n);
 
             // Update the start of the path then continue from the end
             st = nx;
@@ -1491,42 +2831,30 @@ bool obj::trace_a_path(double snaplen, line_iter& st, line_iter& en) {
 }
 
 bool obj::is_clockwise(line_iter st, line_iter en) const {
-   double ang_acc = 0.0;
-   int pos_neg = 0;
-   line_iter prv = prev(en);
-
-   // Acculmulate the relative angles between successive vectors
+   // Twice the signed area enclosed, by the shoelace formula; taken about the first point to keep the products small
+   coord_t org = st->get_S0();
+   double area2 = 0.0;
    for (line_iter ln = st; ln != en; ++ln) {
-      if ((prv->len() > 0.0) && (ln->len() > 0.0)) {
-         double ang = atan2(perpprod(prv->get_V(), ln->get_V()), dotprod(prv->get_V(), ln->get_V()));
-         pos_neg = (ang >= 0.0) ? (pos_neg + 1) : (pos_neg - 1);
-         ang_acc = ang_acc + ang;
-         prv = ln;
-      }
+      coord_t s0 = ln->get_S0();
+      coord_t s1 = ln->get_S1();
+      area2 += perpprodRaw(s0.x - org.x, s0.y - org.y, s1.x - org.x, s1.y - org.y);
    }
-   PR_ANY(": is_clockwise %.1lfrads  pos/neg %d", ang_acc, pos_neg);
+   PR_ANY(": is_clockwise area %.1lf", area2 / 2.0);
 
-   // The accumulation should be close to 360deg otherwise a local loop has been detected
-   if (isEqualWithinPercentage(M_PI * 2.0, fabs(ang_acc), 5.0)) {
-      return (ang_acc < 0.0);
-   }
-   else {
-      PR_WARNING("\nWARNING: is_clockwise() angle is not a 2PI multiple (%.1lf) - using pos/neg counter instead (%d)\n",
-         ang_acc,
-         pos_neg);
-      return (pos_neg < 0);
-   }
+   // Negative area is clockwise
+   return (area2 < 0.0);
 }
 
 void obj::regularise() {
    do {
       make_path();
-   } while (del_dupes_zeros());
+   } while (compact());
 }
 
 void obj::regularise_no_del() {
+   // Keep open paths, but there is no need to copy them out
    std::list<obj> closed, open;
-   make_path(SNAP_LEN, closed, open);
+   make_path(SNAP_LEN, closed, open, false, true);
 }
 
 void obj::startAtDirection(direction_e dir) {
@@ -1537,14 +2865,14 @@ void obj::startAtDirection(direction_e dir) {
    double vpos = (find_extremity(LEFT) + find_extremity(RIGHT)) / 2.0;
    line hline(coord_t{ 0.0, hpos }, vector_t{ 1.0, 0.0 });
    line vline(coord_t{ vpos, 0.0 }, vector_t{ 0.0, 1.0 });
-   std::list<obj_line_intersect> hisects, visects;
+   std::pmr::list<obj_line_intersect> hisects, visects;
    if (!line_intersect(hline, &hisects, true))
       FATAL("Failed to find h-intersect");
    if (!line_intersect(vline, &visects, true))
       FATAL("Failed to find v-intersect");
 
    // Pick the relevant one
-   std::list<obj_line_intersect>::iterator isect;
+   std::pmr::list<obj_line_intersect>::iterator isect;
    switch (dir) {
    case LEFT:
       isect = hisects.begin();
@@ -1576,11 +2904,11 @@ void obj::startAtDirection(direction_e dir) {
 }
 
 coord_t obj::find_avg_centre() const {
-   line_iter ln = e.begin();
+   line_iter ln = begin();
    coord_t c = { 0.0, 0.0 };
    size_t count = 0;
 
-   while (ln != e.end()) {
+   while (ln != end()) {
       c.x = c.x + ln->get_pt(0.5).x;
       c.y = c.y + ln->get_pt(0.5).y;
       count++;
@@ -1593,14 +2921,334 @@ coord_t obj::find_avg_centre() const {
    return (c);
 }
 
-void obj::trace_at_offset(double ofs) {
+bool obj::trace_at_offset(double ofs, trace_style_e style) {
+   switch (style) {
+   case TRACE_SAMPLED:
+      trace_sampled(ofs);
+      return true;
+   case TRACE_EXACT:
+   default:
+      return trace_exact(ofs);
+   }
+}
+
+// Offset one closed path, given as its elements in path order, and add the untrimmed offset loop to raw.
+// Where the offsets of two elements open a gap the loop runs around the corner on lines tangent to the arc of
+// radius |ofs|, or for a shallow turn just extended to meet, so no part of it comes closer than |ofs| to the
+// corner.  Where they overlap it is trimmed to their intersection, or if that is not within both offsets, taken
+// back through the corner itself; either way any remaining overlap is left for trace_exact() to cut away.
+static void offsetClosedPath(const std::pmr::vector<line>& el, double ofs, obj& raw) {
+   enum join_e {
+      J_DIRECT, // Offsets (nearly) meet, just join their ends
+      J_ARC,    // Run around the corner
+      J_MITRE,  // Trim both offsets to their intersection
+      J_CORNER  // Go back through the corner
+   };
+   const size_t m = el.size();
+   const double aStep = TO_RADS(TRACE_ARC_STEP_DEG);
+   std::pmr::vector<line> ol(el);
+   std::pmr::vector<join_e> jn(m);
+   std::pmr::vector<coord_t> mitre(m);
+   std::pmr::vector<double> tS(m, 0.0), tE(m, 1.0);
+
+   for (size_t i = 0; i < m; i++)
+      ol[i].move_sideways(ofs);
+
+   // Choose the join at the end of each element
+   for (size_t i = 0; i < m; i++) {
+      size_t j = (i + 1) % m;
+      double ad = el[i].angle(el[j]);
+      if (ad == 0.0)
+         jn[i] = J_DIRECT;
+      else if (((ad > 0.0) == (ofs < 0.0)) && (std::abs(ad) > aStep))
+         jn[i] = J_ARC;
+      else if ((ad > 0.0) == (ofs < 0.0)) {
+         // A single step around the arc is the tangent through its middle, so just meet at the mitre
+         if (ol[i].lines_intersect(ol[j], &mitre[i], 1))
+            jn[i] = J_MITRE;
+         else
+            jn[i] = J_DIRECT;
+      }
+      else if (!ol[i].lines_intersect(ol[j], &mitre[i], 1))
+         jn[i] = J_DIRECT;
+      else {
+         double ti = ol[i].T_for_pt(mitre[i]);
+         double tj = ol[j].T_for_pt(mitre[i]);
+         if ((ti >= 0.0) && (ti <= 1.0) && (tj >= 0.0) && (tj <= 1.0)) {
+            jn[i] = J_MITRE;
+            tE[i] = ti;
+            tS[j] = tj;
+         }
+         else
+            jn[i] = J_CORNER;
+      }
+   }
+
+   // An offset trimmed from both ends past itself goes back through the corners instead
+   for (size_t i = 0; i < m; i++) {
+      if (tS[i] > tE[i]) {
+         size_t h = (i + m - 1) % m;
+         if (jn[h] == J_MITRE) {
+            jn[h] = J_CORNER;
+            tE[h] = 1.0;
+            tS[i] = 0.0;
+         }
+         if (jn[i] == J_MITRE) {
+            jn[i] = J_CORNER;
+            tE[i] = 1.0;
+            tS[(i + 1) % m] = 0.0;
+         }
+      }
+   }
+
+   for (size_t i = 0; i < m; i++) {
+      size_t h = (i + m - 1) % m;
+      size_t j = (i + 1) % m;
+      coord_t a = (jn[h] == J_MITRE) ? mitre[h] : ol[i].get_S0();
+      coord_t b = (jn[i] == J_MITRE) ? mitre[i] : ol[i].get_S1();
+      coord_t c = el[i].get_S1();
+      raw.add(a, b);
+
+      switch (jn[i]) {
+      case J_DIRECT:
+         raw.add(b, ol[j].get_S0());
+         break;
+      case J_CORNER:
+         raw.add(b, c);
+         raw.add(c, ol[j].get_S0());
+         break;
+      case J_ARC: {
+         // The offset turns through the same angle as the elements; step around it on tangents to the arc
+         double ad = el[i].angle(el[j]);
+         int nSteps = (int)std::ceil(std::abs(ad) / aStep);
+         nSteps = (nSteps < 1) ? 1 : nSteps;
+         double step = ad / nSteps;
+         double rad = std::abs(ofs) / cos(step / 2.0);
+         double a0 = atan2(b.y - c.y, b.x - c.x);
+         coord_t pt = b;
+         for (int k = 1; k <= nSteps; k++) {
+            double ang = a0 + ((k - 0.5) * step);
+            coord_t nxt = { c.x + (rad * cos(ang)), c.y + (rad * sin(ang)) };
+            raw.add(pt, nxt);
+            pt = nxt;
+         }
+         raw.add(pt, ol[j].get_S0());
+         break;
+      }
+      case J_MITRE:
+      default:
+         break;
+      }
+   }
+}
+
+// One piece of an offset loop kept by trace_exact(), and the loop it came from
+struct trace_piece {
+   line ln;
+   size_t loop;
+};
+
+// Drop pieces that have no piece continuing from their end, or none leading into their start.  A crossing that falls
+// within SNAP_LEN of an element end is not cut, which can leave a short spur on the other loop running on past the
+// crossing; make_path() could follow the spur instead of the loop and leave the whole loop open.
+static void pruneDanglingPieces(std::pmr::vector<trace_piece>& pieces) {
+   const size_t n = pieces.size();
+   std::pmr::vector<size_t> byX(n);
+   for (size_t i = 0; i < n; i++)
+      byX[i] = i;
+   std::sort(byX.begin(), byX.end(), [&pieces](size_t a, size_t b) {
+      return pieces[a].ln.get_S0().x < pieces[b].ln.get_S0().x;
+   });
+
+   // Link each piece to the pieces starting where it ends; the links from piece i are outs[outSt[i]..outSt[i + 1])
+   std::pmr::vector<size_t> outs, outSt(n + 1, 0), nOut(n, 0), nIn(n, 0);
+   for (size_t i = 0; i < n; i++) {
+      coord_t s1 = pieces[i].ln.get_S1();
+      auto lo = std::lower_bound(byX.begin(), byX.end(), s1.x - SNAP_LEN, [&pieces](size_t k, double x) {
+         return pieces[k].ln.get_S0().x < x;
+      });
+      for (auto it = lo; (it != byX.end()) && (pieces[*it].ln.get_S0().x <= (s1.x + SNAP_LEN)); ++it) {
+         if ((*it != i) && isSamePoint(s1, pieces[*it].ln.get_S0())) {
+            outs.push_back(*it);
+            nIn[*it]++;
+         }
+      }
+      outSt[i + 1] = outs.size();
+      nOut[i] = outSt[i + 1] - outSt[i];
+   }
+
+   // And the other way, the links into piece j are ins[inSt[j]..inSt[j + 1])
+   std::pmr::vector<size_t> ins(outs.size()), inSt(n + 1, 0);
+   for (size_t j = 0; j < n; j++)
+      inSt[j + 1] = inSt[j] + nIn[j];
+   std::pmr::vector<size_t> fill(inSt.begin(), inSt.end() - 1);
+   for (size_t i = 0; i < n; i++)
+      for (size_t k = outSt[i]; k < outSt[i + 1]; k++)
+         ins[fill[outs[k]]++] = i;
+
+   // Remove dead ends until none are left, since a spur may be more than one piece long
+   std::pmr::vector<uint8_t> gone(n, 0);
+   std::pmr::vector<size_t> todo;
+   for (size_t i = 0; i < n; i++)
+      if (!nOut[i] || !nIn[i])
+         todo.push_back(i);
+   while (!todo.empty()) {
+      size_t i = todo.back();
+      todo.pop_back();
+      if (gone[i])
+         continue;
+      gone[i] = 1;
+      for (size_t k = outSt[i]; k < outSt[i + 1]; k++)
+         if (!gone[outs[k]] && !--nIn[outs[k]])
+            todo.push_back(outs[k]);
+      for (size_t k = inSt[i]; k < inSt[i + 1]; k++)
+         if (!gone[ins[k]] && !--nOut[ins[k]])
+            todo.push_back(ins[k]);
+   }
+
+   size_t kept = 0;
+   for (size_t i = 0; i < n; i++)
+      if (!gone[i])
+         pieces[kept++] = pieces[i];
+   pieces.resize(kept);
+}
+
+bool obj::trace_exact(double ofs) {
+   PR_ANY("\nTrace at offset %.1lf\n", ofs);
+
+   // Ensure all my vectors are clockwise (around centre) and contiguous
+   regularise();
+   if (empty() || (ofs == 0.0))
+      return true;
+
+   // Make an untrimmed offset loop for each closed path; open paths are only handled by the sampled trace
+   obj raw;
+   std::pmr::vector<size_t> loopSt; // First element of each loop in raw
+   for (line_iter st = begin(); st != end();) {
+      std::pmr::vector<line> el;
+      line_iter ln = st;
+      while (true) {
+         el.push_back(*ln);
+         if (isSamePoint(ln->get_S1(), st->get_S0()))
+            break;
+         line_iter nx = next(ln);
+         if (is_end(nx) || !isSamePoint(ln->get_S1(), nx->get_S0()))
+            break;
+         ln = nx;
+      }
+      st = next(ln);
+
+      if ((el.size() < 2) || !isSamePoint(el.back().get_S1(), el.front().get_S0())) {
+         trace_sampled(ofs);
+         return false;
+      }
+      loopSt.push_back(raw.size());
+      offsetClosedPath(el, ofs, raw);
+   }
+   loopSt.push_back(raw.size());
+   const size_t nraw = raw.size();
+
+   // Find where the loops cross themselves or each other
+   struct cut {
+      size_t seg; //!< Element of raw
+      double T;   //!< Ratio along it
+      coord_t pt; //!< Crossing point
+   };
+   std::pmr::vector<cut> cuts;
+   std::pmr::vector<size_t> loopOf(nraw);
+   for (size_t l = 0; (l + 1) < loopSt.size(); l++)
+      for (size_t k = loopSt[l]; k < loopSt[l + 1]; k++)
+         loopOf[k] = l;
+   std::pmr::vector<line_iter> rln;
+   rln.reserve(nraw);
+   segment_sweep sw;
+   sw.reserve(nraw);
+   for (line_iter ln = raw.begin(); ln != raw.end(); ++ln) {
+      rln.push_back(ln);
+      sw.add(*ln);
+   }
+
+   std::vector<segment_sweep::crossing> xs;
+   sw.crossings(xs);
+   for (const segment_sweep::crossing& x : xs) {
+      // Neighbours in the same loop always meet at their shared end
+      size_t i = x.a;
+      size_t j = x.b;
+      size_t l = loopOf[i];
+      if ((loopOf[j] == l) && ((j == (i + 1)) || ((i == loopSt[l]) && (j == (loopSt[l + 1] - 1)))))
+         continue;
+
+      cuts.push_back(cut{ i, rln[i]->T_for_pt(x.pt), x.pt });
+      cuts.push_back(cut{ j, rln[j]->T_for_pt(x.pt), x.pt });
+   }
+   std::sort(cuts.begin(), cuts.end(), [](const cut& a, const cut& b) {
+      return (a.seg < b.seg) || ((a.seg == b.seg) && (a.T < b.T));
+   });
+
+   // Cut the loops into pieces at the crossings and keep the pieces that are a full offset away from this object
+   const double dist = std::abs(ofs) - SMALL_NUM;
+   std::pmr::vector<trace_piece> pieces;
+   size_t kc = 0;
+   for (size_t i = 0; i < nraw; i++) {
+      coord_t from = rln[i]->get_S0();
+      for (; (kc < cuts.size()) && (cuts[kc].seg == i); kc++) {
+         if ((cuts[kc].T <= 0.0) || (cuts[kc].T >= 1.0) || (distTwoPoints(from, cuts[kc].pt) <= SNAP_LEN))
+            continue;
+         if (is_clear_of(averageTwoPoints(from, cuts[kc].pt), dist))
+            pieces.push_back(trace_piece{ line(from, cuts[kc].pt), loopOf[i] });
+         from = cuts[kc].pt;
+      }
+      if ((distTwoPoints(from, rln[i]->get_S1()) > SNAP_LEN) && is_clear_of(averageTwoPoints(from, rln[i]->get_S1()), dist))
+         pieces.push_back(trace_piece{ line(from, rln[i]->get_S1()), loopOf[i] });
+   }
+   const size_t nloops = loopSt.size() - 1;
+   std::pmr::vector<size_t> trimmedOf(nloops, 0), keptOf(nloops, 0);
+   for (const trace_piece& pc : pieces)
+      trimmedOf[pc.loop]++;
+   size_t ntrimmed = pieces.size();
+   pruneDanglingPieces(pieces);
+   DBGLVL2("Offset %zu elements to %zu, %zu crossings, %zu kept, %zu pruned", size(), nraw, cuts.size() / 2, ntrimmed,
+      ntrimmed - pieces.size());
+
+   obj tr;
+   for (const trace_piece& pc : pieces) {
+      tr.add(pc.ln);
+      keptOf[pc.loop]++;
+   }
+
+   // The trimmed loops must all close, and no loop may be lost altogether unless it is an inside trace that trimming
+   // removed completely.  Otherwise the crossings were not resolved cleanly, so trace with the sampled engine instead.
+   tr.regularise_no_del();
+   bool sound = std::all_of(tr.ix.paths.begin(), tr.ix.paths.end(), [](const path_info& pi) { return pi.closed; });
+   for (size_t l = 0; l < nloops; l++)
+      if (!keptOf[l] && ((ofs > 0.0) || trimmedOf[l]))
+         sound = false;
+   if (!sound && !testFlag) {
+      DBGLVL1("Exact offset at %.3lf did not resolve, using the sampled trace", ofs);
+      trace_sampled(ofs);
+      return false;
+   }
+
+   tr.regularise();
+   if (testFlag) // Test code to draw the untrimmed offset
+      tr = raw;
+
+   e.swap(tr.e);
+   std::swap(bb, tr.bb);
+   ix_invalidate();
+   PR_ANY(": Done\n");
+   return true;
+}
+
+void obj::trace_sampled(double ofs) {
    PR_ANY("\nTrace at offset %.1lf\n", ofs);
 
    // Ensure all my vectors are clockwise (around centre) and contiguous
    regularise();
 
    // Create the set of offsetting lines
-   std::list<offset_line> osln;
+   std::pmr::vector<offset_line> osln;
+   osln.reserve(size() * (MIN_TRACE_STEPS + 1));
    int cntOfsPts = 0, cntProxInv = 0, cntCrossing = 0, cntRadial = 0, cntRedundant = 0;
    for (line_iter ln = begin(); ln != end(); ++ln) {
       if (ln->len() < SNAP_LEN)
@@ -1702,19 +3350,26 @@ void obj::trace_at_offset(double ofs) {
       }
    }
 
-   // Invalidate the offsetting lines that cross any other offsetting line
-   for (offset_line_iter ref = osln.begin(); ref != osln.end(); ++ref) {
-      if (std::next(ref) != osln.end()) {
-         for (offset_line_iter cmp = std::next(ref); cmp != osln.end(); ++cmp) {
-            if (cmp->valid && ref->valid) {
-               coord_t dp;
-               if (ref->lines_intersect(*cmp, &dp, 0)) {
-                  ref->valid = false;
-                  cntCrossing++;
-                  break;
-               }
-            }
-         }
+   // Invalidate the offsetting lines that cross any later offsetting line.  Only the proximity pass has invalidated
+   // anything yet, and a line is tested only against later ones, so the result does not depend on the order the
+   // lines are tested in; one sweep over the valid lines finds every pair, and the earlier line of each goes.
+   segment_sweep sw;
+   std::pmr::vector<uint32_t> swLine;
+   sw.reserve(osln.size());
+   swLine.reserve(osln.size());
+   for (uint32_t r = 0; r < (uint32_t)osln.size(); r++) {
+      if (osln[r].valid) {
+         sw.add(osln[r]);
+         swLine.push_back(r);
+      }
+   }
+   std::vector<segment_sweep::crossing> xs;
+   sw.crossings(xs);
+   for (const segment_sweep::crossing& x : xs) {
+      offset_line& ref = osln[swLine[x.a]];
+      if (ref.valid) {
+         ref.valid = false;
+         cntCrossing++;
       }
    }
 
@@ -1755,27 +3410,19 @@ void obj::trace_at_offset(double ofs) {
       }
    }
 
-   e = tr.e;
+   e.swap(tr.e);
+   std::swap(bb, tr.bb);
+   ix_invalidate();
    PR_ANY(": Done\n");
 }
 
 void obj::scale_x_lr(double factor) {
    double left_x = find_extremity(LEFT);
-   line_iter ln = e.begin();
-   while (ln != e.end()) {
-      coord_t new_S0 = { (ln->get_S0().x - left_x) * factor, ln->get_S0().y };
-      coord_t new_S1 = { (ln->get_S1().x - left_x) * factor, ln->get_S1().y };
-      ln->set(new_S0, new_S1);
-      ++ln;
-   }
+   transform(affine_t::translate(-left_x, 0.0).then(affine_t::scale(factor, 1.0)));
 }
 
 void obj::scale(double factor) {
-   for (line_iter ln = e.begin(); ln != e.end(); ++ln) {
-      coord_t new_S0 = { ln->get_S0().x * factor, ln->get_S0().y * factor };
-      coord_t new_S1 = { ln->get_S1().x * factor, ln->get_S1().y * factor };
-      ln->set(new_S0, new_S1);
-   }
+   transform(affine_t::scale(factor, factor));
 }
 
 void obj::move_extremity_to(direction_e dir, double pos) {
@@ -1812,12 +3459,12 @@ void obj::make_gap(line_iter l0, coord_t p0, line_iter l1, coord_t p1, bool noNe
       coord_t s1 = l0->get_S1();
 
       // Shorten segment to reach only pt0
-      l0->set(l0->get_S0(), p0);
+      ref(l0).set(l0->get_S0(), p0);
 
       if (noNewLines) {
          // Instead of inserting new segment, lengthen the next segment
          line_iter n = nextc(l0);
-         n->set(p1, n->get_S1());
+         ref(n).set(p1, n->get_S1());
       }
       else {
          // Insert new segment from pt1
@@ -1826,8 +3473,8 @@ void obj::make_gap(line_iter l0, coord_t p0, line_iter l1, coord_t p1, bool noNe
    }
    else {
       // Shorten to reach only their respective points
-      l0->set(l0->get_S0(), p0);
-      l1->set(p1, l1->get_S1());
+      ref(l0).set(l0->get_S0(), p0);
+      ref(l1).set(p1, l1->get_S1());
    }
 }
 
@@ -1877,58 +3524,118 @@ bool obj::cut_slot(direction_e dir, double xpos, double width, double depth, slo
    return true;
 }
 
-double obj::get_max_line_distance(line_iter st, line_iter en, const line& ln) const {
-   double err = 0.0;
-   line_iter term = next(en);
-   for (line_iter seg = st; seg != term; ++seg) {
-      double d0 = ln.distance_to_point(seg->get_S0());
-      double d1 = ln.distance_to_point(seg->get_S1());
-      err = (d0 > err) ? d0 : err;
-      err = (d1 > err) ? d1 : err;
-   }
-   return err;
-}
-
 size_t obj::simplify() {
    return simplify(SIMPLIFY_ERR);
 }
 
+// One span of a run being simplified, from point a to point b, with its worst point k at distance err from the chord
+struct simplify_span {
+   double err;
+   uint32_t a, b, k;
+   bool operator<(const simplify_span& o) const { return err < o.err; }
+};
+
+// Find the point of run elements a to b-1 furthest from the chord joining point a to point b, where point i is the
+// start of element i and point run.size() is the end of the last element
+static simplify_span simplifySpan(const std::vector<line_iter>& run, uint32_t a, uint32_t b) {
+   coord_t s0 = run[a]->get_S0();
+   coord_t s1 = run[b - 1]->get_S1();
+   line chord(s0, s1);
+   bool isPoint = (distTwoPoints(s0, s1) < SMALL_NUM);
+   simplify_span sp = { 0.0, a, b, a + 1 };
+
+   for (uint32_t j = a; j < b; j++) {
+      double d0 = isPoint ? distTwoPoints(s0, run[j]->get_S0()) : chord.distance_to_point(run[j]->get_S0());
+      double d1 = isPoint ? distTwoPoints(s0, run[j]->get_S1()) : chord.distance_to_point(run[j]->get_S1());
+      if (d0 > sp.err) {
+         sp.err = d0;
+         sp.k = j;
+      }
+      if (d1 > sp.err) {
+         sp.err = d1;
+         sp.k = j + 1;
+      }
+   }
+   sp.k = std::clamp(sp.k, a + 1, b - 1);
+   return sp;
+}
+
 size_t obj::simplify(double error) {
    size_t start_size = size();
-   line_iter st = begin();
-   line_iter en = begin();
+   std::vector<line_iter> run;
+   std::vector<uint8_t> keep;
+   std::vector<uint32_t> cuts;
+   std::priority_queue<simplify_span> spans;
 
+   line_iter st = begin();
    while (!is_end(st)) {
-      while (true) {
-         line_iter ca = next(en);
-
-         // Finished the object
-         if (is_end(ca)) {
-            break;
-         }
-
-         // Terminate if it isn't actually connected
-         if (distTwoPoints(en->get_S1(), ca->get_S0()) > SNAP_LEN) {
+      // Gather a run of connected elements
+      run.clear();
+      run.push_back(st);
+      for (line_iter ca = next(st); !is_end(ca); ca = next(ca)) {
+         if (distTwoPoints(run.back()->get_S1(), ca->get_S0()) > SNAP_LEN)
             break;
+         run.push_back(ca);
+      }
+      st = next(run.back());
+
+      // Split the worst span at its furthest point until every span is within the allowable error
+      uint32_t m = (uint32_t)run.size();
+      keep.assign(m + 1, 0);
+      keep[0] = keep[m] = 1;
+      if (m > 1)
+         spans.push(simplifySpan(run, 0, m));
+      while (!spans.empty() && (spans.top().err >= error)) {
+         simplify_span sp = spans.top();
+         spans.pop();
+         keep[sp.k] = 1;
+         if (sp.k - sp.a > 1)
+            spans.push(simplifySpan(run, sp.a, sp.k));
+         if (sp.b - sp.k > 1)
+            spans.push(simplifySpan(run, sp.k, sp.b));
+      }
+      spans = {};
+
+      // Splitting at the worst point leaves more spans than needed, so refit greedily: from each kept point, join the
+      // following spans while the error still holds, then move the end as far into the first failing span as it allows
+      cuts.clear();
+      for (uint32_t b = 1; b <= m; b++)
+         if (keep[b])
+            cuts.push_back(b);
+      keep.assign(m + 1, 0);
+      keep[0] = keep[m] = 1;
+      uint32_t from = 0;
+      size_t c = 0;
+      while (from < m) {
+         while ((c < cuts.size()) && (cuts[c] <= from + 1))
+            c++;
+         uint32_t lo = from + 1;
+         while ((c < cuts.size()) && (simplifySpan(run, from, cuts[c]).err < error))
+            lo = cuts[c++];
+         uint32_t hi = (c < cuts.size()) ? cuts[c] : lo;
+         while (hi - lo > 1) {
+            uint32_t mid = lo + ((hi - lo) / 2);
+            if (simplifySpan(run, from, mid).err < error)
+               lo = mid;
+            else
+               hi = mid;
          }
+         keep[lo] = 1;
+         from = lo;
+      }
 
-         // Create the simplified line and check its error to each point
-         line sl(st->get_S0(), ca->get_S1());
-         if (get_max_line_distance(st, ca, sl) >= error) {
-            break;
+      // Replace each span with its last element stretched over the span
+      uint32_t a = 0;
+      for (uint32_t b = 1; b <= m; b++) {
+         if (!keep[b])
+            continue;
+         if (b - a > 1) {
+            ref(run[b - 1]).set(run[a]->get_S0(), run[b - 1]->get_S1());
+            for (uint32_t j = a; j < b - 1; j++)
+               del(run[j]);
          }
-
-         // It passes - update end segment and carry on
-         en = ca;
+         a = b;
       }
-
-      // Perform simplification
-      en->set(st->get_S0(), en->get_S1());
-      del(st, en);
-
-      // Next iteration
-      en = next(en);
-      st = en;
    }
 
    return (size_t)(start_size - size());
@@ -1943,13 +3650,13 @@ void obj::extend1mm() {
    line_iter st = begin();
    if (st->len() > 0.0) {
       double factor = -1.0 / st->len();
-      st->set(st->get_pt(factor), st->get_S1());
+      ref(st).set(st->get_pt(factor), st->get_S1());
    }
 
    // Same for the endpoint
    st = last();
    if (st->len() > 0.0) {
       double factor = 1.0 + (1.0 / st->len());
-      st->set(st->get_S0(), st->get_pt(factor));
+      ref(st).set(st->get_S0(), st->get_pt(factor));
    }
 }
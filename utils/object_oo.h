@@ -18,8 +18,15 @@ along with this program.If not, see < https://www.gnu.org/licenses/>.
 
 #define _USE_MATH_DEFINES
 #include <cmath>
+#include <cstdint>
 #include <iterator>
 #include <list>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 // Constants
 #define SMALL_RATIO 1e-5  //!< Ratio below which someting is insignificant
@@ -29,6 +36,12 @@ along with this program.If not, see < https://www.gnu.org/licenses/>.
 #define LARGE 3e3
 #define TRACE_STEP_MM 0.5 //!< For trace_at_offset, maximum size of a trace step in mm
 #define MIN_TRACE_STEPS 4 //!< For trace_at_offset, minimum number of steps per line element
+#define TRACE_ARC_STEP_DEG 3.0 //!< For trace_at_offset, maximum angle of each line approximating a rounded corner
+#define INDEX_MIN_ELEMENTS 64        //!< Objects with fewer elements than this are always searched element by element
+#define INDEX_MIN_QUERIES 2          //!< Number of line queries on an unchanged object before it is worth indexing
+#define INDEX_LEAF_SIZE 4            //!< Maximum elements in a leaf of the line index
+#define INDEX_PAD (10.0 * SNAP_LEN)  //!< Margin around element boxes so that index searches never miss a touching line
+#define SLAB_MAX_ENTRIES 16          //!< A slab index listing more than this many slab entries per element is not worth keeping
 
 //!< Angle macros
 #define TO_RADS(x) ((x)*M_PI / 180.0)
@@ -64,6 +77,13 @@ typedef enum {
    CENGRAD,
 } slot_style_e;
 
+//! Offsetting algorithms for trace_at_offset
+typedef enum {
+   TRACE_EXACT,   //!< Offset each element, join with rounded or trimmed corners then cut away self-intersections;
+                  //!< objects with open paths, or whose trimmed loops do not all close, use TRACE_SAMPLED instead
+   TRACE_SAMPLED, //!< Join the ends of offsetting lines sampled along each element and fanned around corners
+} trace_style_e;
+
 //! States for the makepath function
 typedef enum {
    MP_INIT,
@@ -73,22 +93,20 @@ typedef enum {
 } mpState_e;
 
 //! COORDINATE - a point in space referred to by [x,y] coordinates
+//! Kept as a plain pair of doubles so that points can be copied and packed freely; use coordStr() for display
 class coord_t {
 public:
-   coord_t(double x = 0.0, double y = 0.0)
+   constexpr coord_t(double x = 0.0, double y = 0.0)
       : x(x),
       y(y) {
    }
-   char* prstr() {
-      snprintf(prbuf, 256, "(%.2lf, %.2lf)", x, y);
-      return prbuf;
-   };
    double x;
    double y;
-
-private:
-   char prbuf[256];
 };
+static_assert((sizeof(coord_t) == 2 * sizeof(double)) && std::is_trivially_copyable_v<coord_t>);
+
+//! Format a point for display as (x, y)
+std::string coordStr(coord_t c);
 
 //! VECTOR - a movement referred to by change in x and change in y
 typedef struct vector_s {
@@ -100,6 +118,26 @@ typedef struct vector_s {
    double dy;
 } vector_t;
 
+//! AFFINE TRANSFORM - maps a point p to A.p + t, with A the 2x2 matrix [a b; c d]
+//! Used by line_store to hold a chain of moves, rotations, mirrors and scales as a single pending transform
+class affine_t {
+public:
+   double a = 1.0, b = 0.0, c = 0.0, d = 1.0; //!< Linear part
+   double tx = 0.0, ty = 0.0;                 //!< Translation
+
+   static affine_t translate(double dx, double dy);
+   static affine_t rotate(coord_t pivot, double rads);
+   static affine_t scale(double sx, double sy);
+
+   affine_t then(const affine_t& m) const; //!< This transform followed by m
+   bool is_translation() const {
+      return (a == 1.0) && (b == 0.0) && (c == 0.0) && (d == 1.0);
+   }
+   bool is_identity() const {
+      return is_translation() && (tx == 0.0) && (ty == 0.0);
+   }
+};
+
 //! Check if a values are the same within +/-margin
 bool isEqualWithinMargin(double arg1, double arg2, double margin);
 
@@ -118,6 +156,15 @@ double dotprod(vector_t pt1, vector_t pt2);
 double perpprodRaw(double x1, double y1, double x2, double y2);
 double perpprod(vector_t pt1, vector_t pt2);
 
+//! Robust predicates; a plain double calculation where its error bound allows, otherwise exact arithmetic
+enum cross_e {
+   CROSS_NONE,  //!< The segments do not meet
+   CROSS_TOUCH, //!< An end of one lies on the other, or they overlap collinearly
+   CROSS_PROPER //!< They cross at a single point inside both
+};
+double orient2d(coord_t a, coord_t b, coord_t c);                         //!< Twice the signed area of abc, positive if anticlockwise; the sign is exact
+cross_e segmentsCross(coord_t a0, coord_t a1, coord_t b0, coord_t b1); //!< How segments a0-a1 and b0-b1 meet
+
 //! Point rotation
 void rotatePoint(coord_t* pt, coord_t pivot, double rads);
 
@@ -177,9 +224,9 @@ public:
    void set(coord_t s0, vector_t v0);                 //!< Set using point and a vector
    void set(coord_t s0, double length, double angle); //!< Set using start point, length and angle
 
-   double len() const;     //!< Return length
-   double angle() const;   //!< Return angle in radians
-   double angle(line& l2); //!< Return the angle between two lines
+   double len() const;                 //!< Return length
+   double angle() const;               //!< Return angle in radians
+   double angle(const line& l2) const; //!< Return the angle between two lines
 
    coord_t get_pt(double T) const;    //!< Get a coordinate point on a line based on (T[0.0..1.0] to be in the bounds of the line)
    vector_t get_V() const;            //!< Return the line vector
@@ -204,14 +251,304 @@ public:
    void mirror_x();                                 //!< Mirror around a vertical line at x=0
    void mirror_y();                                 //!< Mirror around a horizontal line at y=0
    void reverse();                                  //!< Swap ends
+   void transform(const affine_t& m);               //!< Map both ends through m
    void set_length(double length);                  //!< Leave S0 where it is, expand the line length
    void extend_S0_mm(double mm);                    //!< If possible, extend the start of the line by mm millimetres
    void extend_S1_mm(double mm);                    //!< If possible, extend the end   of the line by mm millimetres
    void extend_mm(double mm);                       //!< Extend by mm millimetres at both ends
 };
 
-typedef typename std::list<line>::iterator line_iter;
-typedef typename std::list<line>::const_iterator const_line_iter;
+class line_store;
+
+//! LINE HANDLE - a stable reference to a line element held in an obj
+//! Handles stay valid until their element is deleted; adding or deleting other elements, re-ordering paths and
+//! moving the owning obj do not affect them.  They step through the elements in path order like a bidirectional
+//! iterator, but only give read access - changes to an element are made through the owning obj.
+class line_handle {
+public:
+   using iterator_category = std::bidirectional_iterator_tag;
+   using value_type = line;
+   using difference_type = std::ptrdiff_t;
+   using pointer = const line*;
+   using reference = const line&;
+
+   line_handle() = default;
+
+   reference operator*() const;
+   pointer operator->() const;
+   line_handle& operator++();
+   line_handle& operator--();
+   line_handle operator++(int);
+   line_handle operator--(int);
+   bool operator==(const line_handle& h) const = default;
+
+private:
+   friend class obj;
+   line_handle(const line_store* s, uint32_t n)
+      : s(s),
+      n(n) {
+   }
+
+   const line_store* s = nullptr; //!< Store holding the element
+   uint32_t n = 0;                //!< Node index of the element within the store
+};
+
+typedef line_handle line_iter;
+typedef line_handle const_line_iter;
+
+//! LINE STORE - contiguous node pool holding the line elements of an obj
+//! Nodes live in a single vector and are chained into path order by index links; node HEAD is the list head
+//! (the end() position).  Deleted nodes are recycled.  Copies share the node pool, which is reference counted, until
+//! one of them changes it; the one making the change then takes a private copy with the same node numbers, so its
+//! line handles stay valid.
+//! Whole-object moves, rotations, mirrors and scales are composed into one pending transform by transform() and only
+//! applied to the nodes, in a single pass, when an element is next read or added.
+class line_store {
+public:
+   static constexpr uint32_t HEAD = 0;
+
+   line_store();
+   line_store(const line_store& s);
+   line_store& operator=(const line_store& s);
+
+   size_t size() const {
+      return p->cnt;
+   }
+   uint32_t first() const {
+      return nds[HEAD].nxt;
+   }
+   uint32_t last() const {
+      return nds[HEAD].prv;
+   }
+   uint32_t next(uint32_t n) const {
+      return nds[n].nxt;
+   }
+   uint32_t prev(uint32_t n) const {
+      return nds[n].prv;
+   }
+   const line& at(uint32_t n) const {
+      if (tfPending)
+         settle();
+      return nds[n].ln;
+   }
+   line& edit(uint32_t n) { //!< Writable access to the element at node n
+      own();
+      return nds[n].ln;
+   }
+
+   uint32_t insert(uint32_t pos, line ln); //!< Insert a new element ahead of node pos, return its node
+   void erase(uint32_t n);                 //!< Remove node n from the path and recycle it
+   void move(uint32_t pos, uint32_t n);    //!< Relink node n to sit ahead of node pos
+   void clear();                           //!< Remove all elements
+   void reserve(size_t n);                 //!< Reserve space for n elements
+   size_t position(uint32_t n) const;      //!< Position of node n along the path, HEAD gives size()
+   void transform(const affine_t& m);      //!< Follow any pending transform of all the elements with m
+   size_t pool_size() const { //!< Number of nodes in the pool, including HEAD and recycled nodes
+      return p->nd.size();
+   }
+   bool is_shared() const { //!< The node pool is shared with a copy
+      return p.use_count() > 1;
+   }
+
+private:
+   struct node {
+      line ln;
+      uint32_t prv;
+      uint32_t nxt;
+   };
+   //! The nodes, shared by copies of a store until one of them changes
+   struct pool {
+      std::vector<node> nd;             //!< Node pool
+      std::vector<uint32_t> freed = {}; //!< Deleted nodes available for reuse
+      size_t cnt = 0;                   //!< Number of elements in the path
+   };
+
+   void unlink(uint32_t n);
+   void link(uint32_t pos, uint32_t n);
+   void settle() const; //!< Apply the pending transform to every node
+   void own();          //!< Settle, and take a private copy of the pool if it is shared, before a change
+   void rebind() const { //!< Refresh nds after the pool is replaced or reallocated
+      nds = p->nd.data();
+   }
+
+   mutable std::shared_ptr<pool> p;         //!< Nodes; mutable so that a pending transform can be applied on a read
+   mutable node* nds = nullptr;             //!< The nodes of p, for fast access
+   mutable affine_t tf = {};                //!< Transform still to be applied to every node
+   mutable bool tfPending = false;          //!< tf is not the identity
+   mutable std::vector<uint32_t> rank = {}; //!< Cached path position of each node
+   mutable bool rankValid = false;          //!< rank is up to date
+};
+
+inline line_handle::reference line_handle::operator*() const {
+   return s->at(n);
+}
+
+inline line_handle::pointer line_handle::operator->() const {
+   return &s->at(n);
+}
+
+inline line_handle& line_handle::operator++() {
+   n = s->next(n);
+   return *this;
+}
+
+inline line_handle& line_handle::operator--() {
+   n = s->prev(n);
+   return *this;
+}
+
+inline line_handle line_handle::operator++(int) {
+   line_handle h = *this;
+   n = s->next(n);
+   return h;
+}
+
+inline line_handle line_handle::operator--(int) {
+   line_handle h = *this;
+   n = s->prev(n);
+   return h;
+}
+
+//! LINE INDEX - bounding volume hierarchy over the elements of a line_store
+//! Used to find the few elements a query line can touch without testing every element; it holds node numbers so it
+//! stays correct when elements are re-ordered, but must be rebuilt when any element is added, changed or deleted.
+class line_index {
+public:
+   void build(const line_store& s); //!< Index all the elements of s
+   void clear();                    //!< Discard the index, keeping its storage
+   bool valid() const {
+      return !nodes.empty();
+   }
+   void candidates(const line& ln, std::vector<uint32_t>& out) const; //!< Nodes of elements whose box ln passes through
+   void near(coord_t pt, double dist, std::vector<uint32_t>& out) const; //!< Nodes of elements whose box is within dist of pt
+
+private:
+   struct box {
+      double x0, y0, x1, y1;
+   };
+   struct item {
+      box b;      //!< Padded bounding box of the element
+      uint32_t n; //!< Node of the element in the store
+   };
+   struct bnode {
+      box b;          //!< Box enclosing everything below this node
+      uint32_t lft;   //!< Child nodes, or first item of a leaf
+      uint32_t rgt;   //!< Child nodes, or number of items in a leaf
+      bool leaf;
+   };
+
+   uint32_t build(uint32_t lo, uint32_t hi);
+   static bool crosses(const box& b, coord_t p, vector_t d);
+
+   std::vector<item> items;  //!< Elements, grouped by leaf
+   std::vector<bnode> nodes; //!< Tree nodes, the root is node 0
+};
+
+//! X SLAB INDEX - the elements of a line_store grouped into vertical slabs
+//! The x axis is cut at every (padded) element end so that each slab lists just the elements spanning it; the
+//! elements a vertical line can meet are then found by a binary search for its slab.  Like line_index it holds
+//! node numbers, so it survives re-ordering but must be rebuilt when any element is added, changed or deleted.
+class x_slab_index {
+public:
+   bool build(const line_store& s); //!< Index all the elements of s, false if the index would be too large
+   void clear();                    //!< Discard the index, keeping its storage
+   bool valid() const {
+      return !start.empty();
+   }
+   bool oversize() const {
+      return tooBig;
+   }
+   size_t candidates(double x, const uint32_t** first) const; //!< Nodes of the elements spanning x, returns the count
+
+private:
+   std::vector<double> edge;    //!< Slab boundaries in increasing x
+   std::vector<uint32_t> start; //!< First entry in nodes for each slab, followed by the end of the last slab
+   std::vector<uint32_t> nodes; //!< Nodes of the elements spanning each slab
+   bool tooBig = false;         //!< Last build was abandoned as too large
+};
+
+//! ENDPOINT GRID - the ends of the elements of a line_store hashed into square cells
+//! Cells are one snap length across, so every end within the snap length of a point lies in the 3x3 block of cells
+//! around it.  Holds node numbers; elements must not move by more than the snap length while it is in use.
+class endpoint_grid {
+public:
+   void build(const line_store& s, uint32_t from, double snaplen); //!< Hash both ends of the elements of s from node from onwards
+   void near(coord_t pt, std::vector<uint32_t>& out) const;         //!< Append the nodes with an end in the cells around pt
+
+private:
+   uint64_t key(int64_t i, int64_t j) const {
+      return ((uint64_t)i * 0x9E3779B97F4A7C15ull) ^ (uint64_t)j;
+   }
+
+   double cell = 0.0;
+   std::unordered_map<uint64_t, uint32_t> cellOf; //!< Cell number for each occupied cell key
+   std::vector<uint32_t> start;                   //!< First entry in nodes for each cell, followed by the end of the last cell
+   std::vector<uint32_t> nodes;                   //!< Nodes with an end in each cell
+};
+
+//! SEGMENT BATCH - line segments packed as a structure of arrays so that one query line can be tested against many
+//! Each segment is tested exactly as line::lines_intersect() with no extrapolation would test it, so the results are
+//! bit-identical to the scalar path.  The skew case is done four segments at a time with AVX2 when the processor has
+//! it, chosen at run time, otherwise one at a time; the rare near-parallel segments are left for the caller to test
+//! with lines_intersect().
+class segment_batch {
+public:
+   enum result_e : uint8_t {
+      MISS = 0, //!< The segments do not cross
+      HIT,      //!< The segments cross, T is valid
+      PARALLEL  //!< Near-parallel, test with line::lines_intersect()
+   };
+
+   void clear();
+   void reserve(size_t n);
+   void add(const line& ln); //!< Add a segment; segments are numbered in the order they were added
+   size_t size() const {
+      return sx.size();
+   }
+
+   //! Test segments first to first + cnt - 1 against q.  For each, res[k] is set to a result_e and t[k] to the T
+   //! value on the first line of the pair at the crossing; that is q if qFirst, as in q.lines_intersect(segment),
+   //! otherwise the segment, as in segment.lines_intersect(q)
+   void intersect(const line& q, bool qFirst, size_t first, size_t cnt, uint8_t* res, double* t) const;
+   void intersect_listed(const line& q, bool qFirst, const uint32_t* idx, size_t cnt,
+      uint8_t* res, double* t) const; //!< As above for the cnt segments numbered in idx
+
+private:
+   std::vector<double> sx, sy, vx, vy; //!< S0 and V of each segment
+};
+
+//! SEGMENT SWEEP - finds every crossing among a set of line segments
+//! Segments are swept in order of their left ends against a list of the ones still spanning the sweep position,
+//! so only segments whose (padded) boxes overlap are ever tested.  Each pair is tested with line::lines_intersect()
+//! and no extrapolation, exactly as a nested loop over the segments would.  Every segment is still compared with the
+//! whole active list, so after the O(n log n) sort the cost is O(n.a) for a segments spanning a typical sweep position:
+//! fast for short, mostly disjoint segments, but O(n^2) when many long segments overlap in x.  It is not an
+//! O((n + k) log n) Bentley-Ottmann search.
+class segment_sweep {
+public:
+   struct crossing {
+      uint32_t a; //!< Segment number of the first segment, in the order they were added
+      uint32_t b; //!< Segment number of the second segment, always greater than a
+      coord_t pt; //!< Where they cross
+   };
+
+   void clear();
+   void reserve(size_t n);
+   uint32_t add(const line& ln, uint32_t group = 0); //!< Add a segment, returns its segment number
+   size_t size() const {
+      return segs.size();
+   }
+   size_t crossings(std::vector<crossing>& out, bool betweenGroups = false,
+      size_t maxCount = SIZE_MAX) const; //!< Find crossing pairs, optionally only between different groups, sorted by a then b
+
+private:
+   struct seg {
+      line ln;
+      double x0, y0, x1, y1; //!< Padded bounding box
+      uint32_t group;
+   };
+   std::pmr::vector<seg> segs;
+};
 
 double slotWidth(const line& crossLine,
    const line& slottedLine,
@@ -225,7 +562,7 @@ public:
    size_t src_index = 0;
 };
 
-typedef typename std::list<offset_line>::iterator offset_line_iter;
+typedef typename std::pmr::vector<offset_line>::iterator offset_line_iter;
 
 // Used for storing information about an object's intersections with a line
 class obj_line_intersect {
@@ -240,25 +577,137 @@ public:
    coord_t pt;   //!< The pt of intersection
 };
 
+// Used for returning an object's highest and lowest intersects with a vertical line
+class obj_vert_intersect {
+public:
+   bool found = false; //!< The vertical line meets the object
+   coord_t upper;      //!< Highest intersect
+   coord_t lower;      //!< Lowest intersect
+   line_iter it_upper; //!< The line iterator for the element at the highest intersect
+   line_iter it_lower; //!< The line iterator for the element at the lowest intersect
+};
+
+//! GEOMETRY ARENA - pooled memory for the short-lived containers used while building a model
+//! While an arena exists it is the std::pmr default resource, so the intersect lists, offset lines and other std::pmr
+//! working containers draw from its pools and recycle blocks freed by earlier operations instead of going back to the
+//! heap; all its memory is returned in one step when it is destroyed.  Objects themselves still use the heap, so they
+//! may outlive the arena.  Arenas nest, and are not thread safe.  Every pool takes its blocks directly from the heap
+//! rather than from the arena below it, so arenas may be destroyed in any order.
+class geom_arena {
+public:
+   geom_arena();
+   ~geom_arena();
+   geom_arena(const geom_arena&) = delete;
+   geom_arena& operator=(const geom_arena&) = delete;
+
+private:
+   std::pmr::unsynchronized_pool_resource pool;
+   geom_arena* below; //!< The arena that was current before this one
+   static geom_arena* top;
+};
+
 //!< OBJECT
 class obj {
 private:
-   mutable std::list<line> e; //!< Lines comprising this object
+   std::unique_ptr<line_store> e = std::make_unique<line_store>(); //!< Lines comprising this object
+
+   //! Cached bounding box, holding the working state of find_extremity() so that it can be extended one element at a time
+   struct bbox_cache {
+      bool valid = false;   //!< Cache matches the elements in e
+      double ext[4] = {};   //!< Extremity in each direction
+      coord_t ptu[4] = {};  //!< Upper/right end of the points sharing each extremity
+      coord_t ptd[4] = {};  //!< Lower/left end of the points sharing each extremity
+      uint32_t elm[4] = {}; //!< Node of the last element reaching each extremity
+   };
+   mutable bbox_cache bb; //!< Invalidated by element edits, extended by add() and shifted by add_offset()
+
+   //! One entry of the running length table used to find the point at a distance along the object
+   struct length_step {
+      double start; //!< Total length of the elements before this one
+      double len;   //!< Length of this element
+      uint32_t n;   //!< Its node
+   };
+
+   //! One path found by make_path(), kept so that the paths need not be traced again while the elements are unchanged
+   struct path_info {
+      uint32_t first; //!< Node of its first element
+      uint32_t count; //!< Number of elements
+      bool closed;    //!< Closed path, which make_path() has made clockwise
+   };
+
+   //! Normalisation the elements are known to have, so that regularise() can skip work that is already done
+   enum norm_e : uint8_t {
+      NORM_PATHS = 0x01,   //!< Sorted into the paths in ix.paths, closed paths clockwise
+      NORM_COMPACT = 0x02, //!< No duplicated or zero length elements
+      NORM_ALL = 0x03
+   };
+
+   //! Spatial indexes of the elements, each built on demand and discarded whenever the elements change
+   struct index_cache {
+      std::unique_ptr<line_index> lines = nullptr;   //!< For line queries
+      size_t lineQueries = 0;                        //!< Line queries made since the elements last changed
+      std::unique_ptr<x_slab_index> slabs = nullptr; //!< For vertical line queries
+      size_t slabQueries = 0;                        //!< Vertical line queries made since the elements last changed
+      std::unique_ptr<segment_batch> batch = nullptr; //!< Elements packed by node number for batched line tests
+      std::vector<length_step> lengths;              //!< Running length of the elements in path order, empty until needed
+      std::vector<path_info> paths;                  //!< Paths in element order from the last make_path(), empty until then
+      double pathSnap = 0.0;                         //!< Snap length those paths were found with
+      uint8_t norm = 0;                              //!< NORM_ flags for the normalisation already done
+   };
+   mutable index_cache ix;
+
+   line& ref(line_iter ln);                      //!< Writable access to one of this object's elements; invalidates the caches
+   void bb_reset() const;                        //!< Start an empty, valid bounding box
+   void bb_include(uint32_t n) const;            //!< Extend the bounding box with element node n
+   void ix_invalidate(uint8_t keep = 0) const;   //!< Discard the spatial indexes after the elements have changed, keeping the NORM_ flags in keep
+   void ix_copy_norm(const obj& o) const;        //!< Take o's normalisation, after taking a shared copy of its elements
+   const line_index* indexed(size_t nq) const;   //!< The line index, if it is worth using for another nq line queries
+   const x_slab_index* slab_indexed() const;     //!< The slab index, if it is worth using for another vertical query
+   const segment_batch& batched() const;         //!< The elements packed for batched line tests
+   const std::vector<length_step>& length_table() const; //!< The running length table, built if it is not current
+   void index_candidates(const line& ln, const line_index* idx,
+      std::vector<uint32_t>& out) const;         //!< Nodes of the elements ln may touch, in path order
+   bool is_clear_of(coord_t pt, double d) const; //!< True if no element comes closer to pt than d
+
+   //! Progress of a search for the lowest and highest intersects with a vertical line
+   struct tb_state {
+      bool found = false;
+      double tlo = 0.0, thi = 0.0;                             //!< T of the lowest and highest hits along the line
+      uint32_t nlo = line_store::HEAD, nhi = line_store::HEAD; //!< Elements holding them
+      coord_t plo, phi;                                        //!< The hits
+   };
+   void tb_test(const line& ref, uint32_t n, bool byPosition,
+      tb_state& st) const; //!< Test element n against vertical line ref; byPosition if elements are not visited in path order
 
    bool test_extremity(direction_e dir, double var, double* res, coord_t* ptu,
       coord_t* ptd,
       coord_t inPt) const;
    bool sX_is_at(coord_t pt, line_iter& ln, double T) const;
-   bool del_dupes_zeros();
+   size_t del_matching(bool dupes, bool zeros); //!< Remove duplicated and/or zero length lines in one pass, return count
    void make_path(double snaplen, std::list<obj>& closed, std::list<obj>& open,
       bool listPaths,
       bool keepOpens);
-   bool trace_a_path(double snaplen, line_iter& st, line_iter& en);                //!< Make a path starting at st, return true if it is a closed path. st points to first element, en to element after the last
-   double get_max_line_distance(line_iter st, line_iter en, const line& ln) const; //!< Max distance of ln from the points of all elements st to en inclusive
+
+   //! Lookup state for make_path() on larger objects, so the next element of a path is found without a scan
+   struct path_joiner {
+      bool ready = false;             //!< The grid is built and matches the elements not yet in a path
+      endpoint_grid grid;             //!< Ends of the elements not yet in a path when the grid was built
+      std::vector<uint32_t> rank;     //!< Order of those elements along the object
+      std::vector<uint8_t> used;      //!< Node is already part of a path
+      std::vector<uint32_t> cand = {};
+   };
+   bool trace_a_path(double snaplen, line_iter& st, line_iter& en,
+      path_joiner* pj = nullptr);                                                  //!< Make a path starting at st, return true if it is a closed path. st points to first element, en to element after the last
    void startAtDirection(direction_e dir, line_iter st, line_iter en);             //!< See public function comments
+   bool trace_exact(double ofs);                                                   //!< trace_at_offset() using TRACE_EXACT
+   void trace_sampled(double ofs);                                                 //!< trace_at_offset() using TRACE_SAMPLED
 
 public:
    obj() = default;
+   obj(const obj& o);
+   obj(obj&& o);
+   obj& operator=(const obj& o);
+   obj& operator=(obj&& o);
    obj(coord_t s0, coord_t s1);  //!< Initialise with a line between two points
    obj(coord_t s0, vector_t v0); //!< Initialise with a line of a vector from a point
    explicit obj(line ln);        //!< Initialise with a copy of a line
@@ -274,11 +723,12 @@ public:
    void add_dotted(const line& ln, double marklen, double splen);        //!< Add line as a dotted
    void add_ellipse(coord_t centre, double rX, double rY);               //!< Add an ellipse at centre with X and Y radiuses
    void move_back_to_front();                                            //!< Move the last added element to the front of the object
+   void set(line_iter ln, coord_t s0, coord_t s1);                       //!< Reposition an existing element between two points
 
    //!< Add elements from another object
    void splice(obj& o);                     //!< Concatenate o onto this object
    void splice(line_iter pos_in_o, obj& o); //!< Same, starting at pos_in_o in object o
-   void copy_from(obj& o);                  //!< Same as splice but copies
+   void copy_from(obj& o);                  //!< Same as splice but copies; into an empty object it shares o's elements
 
    // Delete line elements
    void del(line_iter& iter);                   //!< Delete the referenced line
@@ -286,6 +736,7 @@ public:
    void del();                                  //!< Delete all lines
    size_t del_duplicates();                     //!< Remove all but one of duplicated lines, the first found is kept, return count
    size_t del_zero_lens();                      //!< Remove lines of zero length, return count
+   size_t compact();                            //!< Remove both duplicated and zero length lines, return count
    size_t remove_verticals();                   //!< Remove vertical lines, return count
 
    // Position elements
@@ -307,20 +758,23 @@ public:
    bool empty() const;                                  //!< True if empty (no elements)
    size_t size() const;                                 //!< Number of elements
    double len() const;                                  //!< Total length of all elements
-   size_t index(line_iter ln) const;                    //!< Index of the element at ln, starting at 0
+   size_t index(line_iter ln) const;                    //!< Index of the element at ln, starting at 0; O(1) once cached
    bool is_clockwise(line_iter st, line_iter en) const; //!< The closed path bounded by the iterators is clockwise?
    coord_t get_sp() const;                              //!< Get the first point of the first element
    coord_t get_ep() const;                              //!< Get the last point of the last element
    coord_t get_pt_along_length(double dist) const;      //!< Return the point which is dist along the object
    coord_t get_pt_along_length(double dist, line_iter& ln) const;
    coord_t get_pt_along_length(double dist, line_iter& ln, double& T) const;
+   size_t get_pts_along_length(double start, double spacing, size_t n, std::vector<coord_t>& pts,
+      std::vector<line_iter>* lns = nullptr) const; //!< The n points start, start + spacing, ... along the object in one walk, returns number placed
    bool s0_is_at(coord_t pt, line_iter& ln) const; //!< Find a line segment where S0 = pt
    bool s1_is_at(coord_t pt, line_iter& ln) const; //!< Find a line segment where S1 = pt
    coord_t originIsAt() const;                     //!< The bottom left corner of the bounding box
 
    bool findMarkerSquare(double size, coord_t* centre, bool deleteIt); //!< Find a marker square of side-dimension size
 
-   bool obj_intersect(obj& o) const; //!< Find if o intersects this object
+   bool obj_intersect(obj& o) const;          //!< Find if o intersects this object
+   line extrapolate_across(line l2) const;    //!< Extend l2 until it crosses the whole bounding box of this object
    bool surrounds_point(coord_t pt); //!< True if this object surrounds pt; assumes this object is a closed path
 
    /**
@@ -330,15 +784,18 @@ public:
     *                isects will be sorted in order of increasing T value along l2
     * @param allowExtrapolation Set nonzero to allow extrapolation of the line l2
     * @return True if an intersect was found
+    * Builds and sorts the whole list; for just the highest and lowest hits of a vertical line use top_bot_intersect()
     */
-   bool line_intersect(line l2, std::list<obj_line_intersect>* isects, int allowExtrapolation) const;
+   bool line_intersect(line l2, std::pmr::list<obj_line_intersect>* isects, int allowExtrapolation) const;
    line_iter line_intersect(const line& l2, coord_t* i, int allowExtrapolation) const;               //!< Find if l2 intersects this object
    line_iter line_intersect(line_iter l1, const line& l2, coord_t* i, int allowExtrapolation) const; //!< Same but search from l1 onwards
 
    bool top_bot_intersect(double xpos, coord_t* upper, coord_t* lower,
       line_iter& it_upper,
-      line_iter& it_lower) const; //!< Find highest and lowest intersects of a vertical line through xpos
+      line_iter& it_lower) const; //!< Find highest and lowest intersects of a vertical line through xpos; amortised, no per-query list or sort
    bool top_bot_intersect(double xpos, coord_t* upper, coord_t* lower) const;
+   size_t top_bot_intersect(const std::vector<double>& xpos,
+      std::vector<obj_vert_intersect>& res) const; //!< Same for each of an increasing set of xpos in a single sweep, returns number found
    bool top_intersect(double xpos, coord_t* pt, line_iter& ln) const; //!< Find highest intersect of a vertical line through xpos
    bool bot_intersect(double xpos, coord_t* pt, line_iter& ln) const; //!< Find lowest intersect of a vertical line through xpos
    bool dir_intersect(direction_e dir, double xpos, coord_t* pt,
@@ -354,11 +811,13 @@ public:
    coord_t find_avg_centre() const; //!< Find the average coordinate of the object
 
    //!< Manipulation
+   void transform(const affine_t& m);               //!< Map every element through m; applied lazily when next read
    void add_offset(double xOffset, double yOffset); //!< Move in x and/or y
    void rotate(coord_t pivot, double rads);         //!< Rotate around a point
    void mirror_x();                                 //!< Mirror around a vertical line at x=0
    void mirror_y();                                 //!< Mirror around a horizontal line at y=0
-   void trace_at_offset(double ofs);                //!< Replace the object with a trace at offset ofs - +ve->outside trace, -ve->inside trace
+   bool trace_at_offset(double ofs,
+      trace_style_e style = TRACE_SAMPLED);         //!< Replace the object with a trace at offset ofs - +ve->outside trace, -ve->inside trace; false if TRACE_EXACT fell back to TRACE_SAMPLED
    void make_path(                                  //!< Sort an object into open and closed paths based on snaplen; closed paths are made clockwise
       double snaplen,
       std::list<obj>& closed,
@@ -414,13 +873,13 @@ public:
       const line ln,
       obj& left,
       obj& right,
-      std::list<obj_line_intersect>* isects = NULL);
+      std::pmr::list<obj_line_intersect>* isects = NULL);
    void split_along_line_rejoin( //!< As above, but rejoin the split ends
       const line ln,
       obj& left,
       obj& right,
-      std::list<obj_line_intersect>* isects = NULL);
-   size_t simplify(double error); //!< Reduce number of line elements with a maximum allowable error distance
+      std::pmr::list<obj_line_intersect>* isects = NULL);
+   size_t simplify(double error); //!< Reduce number of line elements with a maximum allowable error distance, each connected run simplified separately
    size_t simplify();             //!< As above using default value for error; both functions return the count of deleted elements
    void extend1mm();              //!< Extend start and finish by 1mm if possible
 
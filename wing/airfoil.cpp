@@ -17,6 +17,7 @@ along with this program.If not, see < https://www.gnu.org/licenses/>.
 #define _USE_MATH_DEFINES
 #define _CRT_SECURE_NO_WARNINGS
 
+#include <algorithm>
 #include <assert.h>
 #include <cmath>
 
@@ -24,7 +25,7 @@ along with this program.If not, see < https://www.gnu.org/licenses/>.
 #include "debug.h"
 #include "hpgl.h"
 
-Airfoil::Airfoil(obj& dwg) {
+Airfoil::Airfoil(obj& dwg, bool spline) {
    vec = dwg;
 
    // Move drawing to left edge at 0.0 and find the choord
@@ -35,6 +36,109 @@ Airfoil::Airfoil(obj& dwg) {
    // Create the normalised airfoil outline
    vec.scale(factor);
    vec.add_offset(-chord_os, 0.0);
+
+   // Between two neighbouring element ends, an outline of one upper and one lower surface is spanned by just two
+   // elements.  Note them so that a lookup there need only intersect those two.
+   for (line_iter ln = vec.begin(); ln != vec.end(); ++ln) {
+      sx.push_back(ln->get_S0().x);
+      sx.push_back(ln->get_S1().x);
+   }
+   std::sort(sx.begin(), sx.end());
+   sx.erase(std::unique(sx.begin(), sx.end()), sx.end());
+   spans.resize(sx.empty() ? 0 : sx.size() - 1);
+   for (line_iter ln = vec.begin(); ln != vec.end(); ++ln) {
+      double lo = std::min(ln->get_S0().x, ln->get_S1().x);
+      double hi = std::max(ln->get_S0().x, ln->get_S1().x);
+      size_t k0 = std::lower_bound(sx.begin(), sx.end(), lo) - sx.begin();
+      size_t k1 = std::lower_bound(sx.begin(), sx.end(), hi) - sx.begin();
+      for (size_t k = k0; k < k1; k++) {
+         if (spans[k].cnt < 2)
+            spans[k].ln[spans[k].cnt] = *ln;
+         spans[k].cnt++;
+      }
+   }
+
+   if (spline) {
+      smooth = fit_surfaces();
+      if (!smooth)
+         DBGLVL1("Airfoil surfaces do not suit a spline, interpolating the outline instead");
+   }
+}
+
+bool Airfoil::fit_surfaces() {
+   // The outline as a run of points, which needs its elements in order
+   std::vector<coord_t> pts;
+   for (line_iter ln = vec.begin(); ln != vec.end(); ++ln) {
+      if (pts.empty())
+         pts.push_back(ln->get_S0());
+      else if (distTwoPoints(ln->get_S0(), pts.back()) > SMALL_NUM)
+         return false;
+      pts.push_back(ln->get_S1());
+   }
+
+   // Split it at the leading edge; both ways from there x must only fall.  Files often have two points at the
+   // front, one for each surface.
+   size_t le = 0;
+   for (size_t k = 1; k < pts.size(); k++)
+      if (pts[k].x > pts[le].x)
+         le = k;
+   le_x = pts[le].x;
+   size_t le2 = ((le + 1 < pts.size()) && (pts[le + 1].x == le_x)) ? le + 1 : le;
+   surface a, b;
+   for (size_t k = le + 1; k-- > 0;) {
+      a.u.push_back(sqrt(le_x - pts[k].x));
+      a.y.push_back(pts[k].y);
+   }
+   for (size_t k = le2; k < pts.size(); k++) {
+      b.u.push_back(sqrt(le_x - pts[k].x));
+      b.y.push_back(pts[k].y);
+   }
+   for (surface* sf : { &a, &b }) {
+      if (sf->u.size() < 3)
+         return false;
+      for (size_t k = 1; k < sf->u.size(); k++)
+         if (sf->u[k] <= sf->u[k - 1])
+            return false;
+      sf->fit();
+   }
+
+   // Whichever lies higher on average is the top
+   double ma = 0.0, mb = 0.0;
+   for (double y : a.y)
+      ma += y / a.y.size();
+   for (double y : b.y)
+      mb += y / b.y.size();
+   upper = (ma > mb) ? a : b;
+   lower = (ma > mb) ? b : a;
+   return true;
+}
+
+void Airfoil::surface::fit() {
+   // Tridiagonal system for the second derivatives, zero at both ends
+   size_t n = u.size();
+   m.assign(n, 0.0);
+   std::vector<double> c(n, 0.0);
+   for (size_t k = 1; k + 1 < n; k++) {
+      double h0 = u[k] - u[k - 1];
+      double h1 = u[k + 1] - u[k];
+      double rhs = 6.0 * (((y[k + 1] - y[k]) / h1) - ((y[k] - y[k - 1]) / h0));
+      double piv = (2.0 * (h0 + h1)) - (h0 * c[k - 1]);
+      c[k] = h1 / piv;
+      m[k] = (rhs - (h0 * m[k - 1])) / piv;
+   }
+   for (size_t k = n - 2; k > 0; k--)
+      m[k] -= c[k] * m[k + 1];
+}
+
+double Airfoil::surface::at(double uq) const {
+   uq = (uq < u.front()) ? u.front() : uq;
+   uq = (uq > u.back()) ? u.back() : uq;
+   size_t k = std::upper_bound(u.begin(), u.end(), uq) - u.begin();
+   k = (k < 1) ? 1 : ((k > u.size() - 1) ? u.size() - 1 : k);
+   double h = u[k] - u[k - 1];
+   double a = (u[k] - uq) / h;
+   double b = 1.0 - a;
+   return (a * y[k - 1]) + (b * y[k]) + ((((a * a * a) - a) * m[k - 1]) + (((b * b * b) - b) * m[k])) * (h * h) / 6.0;
 }
 
 double Airfoil::interp(double v0, double v1, double r) {
@@ -53,7 +157,33 @@ void Airfoil::get_norm_y(double c, double* ty, double* by) {
    c = (c < 0.0) ? 0.0 : c;
    c = (c > 1.0) ? 1.0 : c;
 
-   // Find points
+   // The splines are closed form
+   if (smooth) {
+      double u = (c < le_x) ? sqrt(le_x - c) : 0.0;
+      *ty = upper.at(u);
+      *by = lower.at(u);
+      return;
+   }
+
+   // Strictly inside a span of just two elements, intersect those the same way top_bot_intersect() would; equal
+   // hits resolve in element order as it does
+   auto it = std::upper_bound(sx.begin(), sx.end(), c);
+   if ((it != sx.begin()) && (it != sx.end()) && (*(it - 1) != c)) {
+      const span& sp = spans[(it - sx.begin()) - 1];
+      if (sp.cnt == 2) {
+         line ref = vec.extrapolate_across(line(coord_t{ c, 0.0 }, coord_t{ c, 1.0 }));
+         coord_t p0, p1;
+         if (sp.ln[0].lines_intersect(ref, &p0, 0) && sp.ln[1].lines_intersect(ref, &p1, 0)) {
+            double t0 = ref.T_for_pt(p0);
+            double t1 = ref.T_for_pt(p1);
+            *ty = (t0 > t1) ? p0.y : p1.y;
+            *by = (t1 < t0) ? p1.y : p0.y;
+            return;
+         }
+      }
+   }
+
+   // Otherwise find points
    coord_t upper, lower;
 
    if (!vec.top_bot_intersect(c, &upper, &lower))
@@ -83,8 +213,8 @@ double Airfoil::get_b(double xpos, double choord) {
    return (choord * get_norm_b(xpos / choord));
 }
 
-Airfoil_ref::Airfoil_ref(obj& dwg, double xpos)
-   : Airfoil(dwg),
+Airfoil_ref::Airfoil_ref(obj& dwg, double xpos, bool spline)
+   : Airfoil(dwg, spline),
    xpos{ xpos } {
 }
 
@@ -114,7 +244,7 @@ bool Airfoil_set::add(GenericTab* T, std::string& log) {
          xs.emplace_back(xVals.at(e).toDouble());
          ys.emplace_back(yVals.at(e).toDouble());
       }
-      add_af_from_vectors(T->gdbl(r, "X"), xs, ys);
+      add_af_from_vectors(T->gdbl(r, "X"), xs, ys, T->gqst(r, "INTERP") == QString("Spline"));
    }
    return true;
 }
@@ -122,9 +252,11 @@ bool Airfoil_set::add(GenericTab* T, std::string& log) {
 void Airfoil_set::draft_mode() {
    draw_x_steps = draw_x_steps_draft;
    draw_x_step = 1.0 / (double)(draw_x_steps - 1);
+   draw_err = draw_err_draft;
+   generated.clear();
 }
 
-bool Airfoil_set::add_af_from_vectors(double xpos, const std::vector<double>& xs, const std::vector<double>& ys) {
+bool Airfoil_set::add_af_from_vectors(double xpos, const std::vector<double>& xs, const std::vector<double>& ys, bool spline) {
    if (xs.empty() || (xs.size() != ys.size()))
       return false;
 
@@ -133,12 +265,13 @@ bool Airfoil_set::add_af_from_vectors(double xpos, const std::vector<double>& xs
       imp.add(coord_t{ xs.at(idx), ys.at(idx) });
 
    imp.del_zero_lens();
-   airfoils.emplace_back(Airfoil_ref(imp, xpos));
+   airfoils.emplace_back(Airfoil_ref(imp, xpos, spline));
    airfoils.sort(airfoil_ref_sort_left_right);
+   generated.clear();
    return true;
 }
 
-bool Airfoil_set::add_from_dat_file(FILE** fp, double xpos, bool invert) {
+bool Airfoil_set::add_from_dat_file(FILE** fp, double xpos, bool invert, bool spline) {
    obj imp;
    char line[256];
    bool doneAirfoilName = false;
@@ -174,8 +307,9 @@ bool Airfoil_set::add_from_dat_file(FILE** fp, double xpos, bool invert) {
 
    imp.del_zero_lens();
 
-   airfoils.emplace_back(Airfoil_ref(imp, xpos));
+   airfoils.emplace_back(Airfoil_ref(imp, xpos, spline));
    airfoils.sort(airfoil_ref_sort_left_right);
+   generated.clear();
 
    DBGLVL1("Imported line elements # %zu", imp.size());
 
@@ -183,77 +317,208 @@ bool Airfoil_set::add_from_dat_file(FILE** fp, double xpos, bool invert) {
 }
 
 obj Airfoil_set::generate_airfoil(line planLine, double te_thck, double te_bl, obj& LE, obj& TE) const {
+   // Ribs and LE templates often ask for the same airfoil, so remember what has been asked for.  Without a trailing
+   // edge thickness there is no blend, so the blend length makes no difference.
+   gen_key k{ planLine.get_S0().x, planLine.get_S0().y, planLine.get_V().dx, planLine.get_V().dy, te_thck,
+      (te_thck != 0.0) ? te_bl : 0.0, draw_x_steps, &LE, &TE };
+   auto it = generated.find(k);
+   if (it != generated.end()) {
+      genHits++;
+      return it->second;
+   }
+   genMisses++;
+   obj af = build_airfoil(planLine, te_thck, te_bl, LE, TE);
+   if (!af.empty())
+      generated.emplace(k, af);
+   return af;
+}
+
+obj Airfoil_set::build_airfoil(line planLine, double te_thck, double te_bl, obj& LE, obj& TE) const {
    if (airfoils.size() <= 1) {
       dbg::alert(SS("Need at least 2 airfoils defined, cannot generate rib"));
       return obj();
    }
 
+   // Work along the planform line non-linearly, over the stations of a fixed cosine spacing.  Start with a coarse
+   // subset, then keep drawing stations across any gap where the surface bends away from a straight line by more than
+   // draw_err.  Flat stretches end up with few points and curved ones with all of them.
+   struct station {
+      size_t i;     // Index of the station
+      coord_t t, b; // Top and bottom points
+      bool flat;    // The gap up to the next station needs no more stations
+   };
+   std::vector<station> sts;
+   std::vector<size_t> at, probes;
+   std::vector<coord_t> top, bot;
+   size_t stride = std::max<size_t>(1, (draw_x_steps - 1) / draw_x_steps_min);
+   for (size_t i = 0; i < draw_x_steps; i += stride)
+      at.push_back(i);
+   if (at.back() != draw_x_steps - 1)
+      at.push_back(draw_x_steps - 1);
+   draw_stations(at, planLine, te_thck, te_bl, LE, TE, top, bot);
+   for (size_t k = 0; k < at.size(); k++)
+      sts.push_back(station{ at[k], top[k], bot[k], false });
+
+   for (;;) {
+      // Probe each unfinished gap at its midpoint and quarter points, as far as the stations allow; probes[k] is the
+      // first probe of gap k in at, and probes[k + 1] the end
+      at.clear();
+      probes.assign(1, 0);
+      for (size_t k = 0; k + 1 < sts.size(); k++) {
+         size_t lo = sts[k].i, hi = sts[k + 1].i;
+         if (!sts[k].flat && (hi - lo > 1)) {
+            size_t mid = (lo + hi) / 2;
+            for (size_t p : { (lo + mid) / 2, mid, (mid + hi) / 2 })
+               if ((p > lo) && (p < hi) && (at.empty() || (p > at.back())))
+                  at.push_back(p);
+         }
+         probes.push_back(at.size());
+      }
+      if (at.empty())
+         break;
+      draw_stations(at, planLine, te_thck, te_bl, LE, TE, top, bot);
+
+      // A gap is done if every probe is near the line across it, otherwise the probes become stations.  Stations
+      // between the probes are not looked at, so leave some margin for them.
+      double tol = 0.75 * draw_err;
+      std::vector<station> nxt;
+      nxt.reserve(sts.size() + at.size());
+      for (size_t k = 0; k < sts.size(); k++) {
+         nxt.push_back(sts[k]);
+         if ((k + 1 == sts.size()) || (probes[k] == probes[k + 1]))
+            continue;
+         line tc(sts[k].t, sts[k + 1].t), bc(sts[k].b, sts[k + 1].b);
+         bool flat = true;
+         for (size_t m = probes[k]; flat && (m < probes[k + 1]); m++)
+            flat = (tc.distance_to_point(top[m]) <= tol) && (bc.distance_to_point(bot[m]) <= tol);
+         if (flat)
+            nxt.back().flat = true;
+         else
+            for (size_t m = probes[k]; m < probes[k + 1]; m++)
+               nxt.push_back(station{ at[m], top[m], bot[m], false });
+      }
+      sts.swap(nxt);
+   }
+
+   // Add to the airfoil lines
    obj topln, botln;
+   for (const station& st : sts) {
+      topln.add(st.t);
+      botln.add(st.b);
+   }
 
-   // Work along the planform line non-linearly
-   for (size_t i = 0; i < draw_x_steps; i++) {
+   topln.del_zero_lens();
+   botln.del_zero_lens();
+
+   // Combine into a drawing
+   obj airf;
+   airf.add(topln.get_sp(), botln.get_sp());
+   airf.add(topln.get_ep(), botln.get_ep());
+   airf.splice(topln);
+   airf.splice(botln);
+   airf.regularise();
+   return airf;
+}
+
+void Airfoil_set::draw_stations(const std::vector<size_t>& at, line planLine, double te_thck, double te_bl, obj& LE,
+   obj& TE, std::vector<coord_t>& top, std::vector<coord_t>& bot) const {
+   // Each pass below covers every station before the next starts
+   const size_t n = at.size();
+   std::vector<double> xpos(n), xpart(n), planY(n);
+   for (size_t i = 0; i < n; i++) {
       // Get the x position in the wing that we are working at.  This uses a cosine transformation to concentrate the
       // points around the leading and trailing edges (similar to what Profili and the like seem to do).
-      double c = 0.5 * (1 - cos(i * draw_x_step * M_PI));
+      double c = 0.5 * (1 - cos(at[i] * draw_x_step * M_PI));
       c = (c < 0.0) ? 0.0 : c;
       c = (c > 1.0) ? 1.0 : c;
 
       // xpos is the x position we are at in the wing
       // xpart is x position we are at along the part
       coord_t planPt = planLine.get_pt(c);
-      double xpos = planPt.x;
-      double xpart = distTwoPoints(planLine.get_S0(), planPt);
+      xpos[i] = planPt.x;
+      xpart[i] = distTwoPoints(planLine.get_S0(), planPt);
+      planY[i] = planPt.y;
+   }
 
-      // Find the wing choord at xpos
-      coord_t le_pt, te_pt;
-      line_iter dln;
-      if (!LE.top_intersect(xpos, &le_pt, dln) || !TE.top_intersect(xpos, &te_pt, dln))
-         dbg::fatal(SS("Failed to find LE/TE intersect at X position ") + TS(xpos));
-      double choord = le_pt.y - te_pt.y;
+   // Find the wing choord at every xpos with one sweep along each of the LE and TE.  The stations run along x one way
+   // or the other, so reverse them if the sweep needs them to.
+   bool rev = (n > 1) && (xpos[n - 1] < xpos[0]);
+   std::vector<double> xs(xpos);
+   if (rev)
+      std::reverse(xs.begin(), xs.end());
+   std::vector<obj_vert_intersect> les, tes;
+   LE.top_bot_intersect(xs, les);
+   TE.top_bot_intersect(xs, tes);
+
+   std::vector<double> choord(n), wc(n);
+   for (size_t i = 0; i < n; i++) {
+      const obj_vert_intersect& le = les[rev ? (n - 1 - i) : i];
+      const obj_vert_intersect& te = tes[rev ? (n - 1 - i) : i];
+      if (!le.found || !te.found)
+         dbg::fatal(SS("Failed to find LE/TE intersect at X position ") + TS(xpos[i]));
+      choord[i] = le.upper.y - te.upper.y;
 
       // Find the length ratio along the wing choord for the point we are interested in
-      double wc = (planPt.y - te_pt.y) / choord;
+      wc[i] = (planY[i] - te.upper.y) / choord[i];
+   }
 
-      // Find the airfoil references that are in play and a position ratio between them
-      std::list<Airfoil_ref>::iterator i0, i1;
-      findEnclosingAirfoils(xpos, i0, i1);
+   // Look up the top and bottom of the airfoil references that are in play at each station.  Neighbouring stations
+   // usually share them, and their trailing edges, so those are only found again when xpos moves.
+   std::vector<double> t0(n), t1(n), b0(n), b1(n), x0(n), x1(n), tte0(n), tte1(n), bte0(n), bte1(n);
+   std::list<Airfoil_ref>::iterator i0{}, i1{};
+   double te[4] = {};
+   for (size_t i = 0; i < n; i++) {
+      if ((i == 0) || (xpos[i] != xpos[i - 1])) {
+         std::list<Airfoil_ref>::iterator was0 = i0, was1 = i1;
+         findEnclosingAirfoils(xpos[i], i0, i1);
+         if ((te_thck != 0.0) && ((i == 0) || (i0 != was0) || (i1 != was1))) {
+            i0->get_norm_y(0.0, &te[0], &te[2]);
+            i1->get_norm_y(0.0, &te[1], &te[3]);
+         }
+      }
+      i0->get_norm_y(wc[i], &t0[i], &b0[i]);
+      i1->get_norm_y(wc[i], &t1[i], &b1[i]);
+      x0[i] = i0->get_X();
+      x1[i] = i1->get_X();
+      tte0[i] = te[0];
+      tte1[i] = te[1];
+      bte0[i] = te[2];
+      bte1[i] = te[3];
+   }
+
+   // Interpolate to find the top and bottom points of the airfoil at each station
+   std::vector<double> top_y(n), bot_y(n);
+   for (size_t i = 0; i < n; i++) {
+      top_y[i] = Airfoil::interp(t0[i], t1[i], x0[i], x1[i], xpos[i]) * choord[i];
+      bot_y[i] = Airfoil::interp(b0[i], b1[i], x0[i], x1[i], xpos[i]) * choord[i];
+   }
 
-      // Interpolate to find the top and bottom points of the airfoil at this location
-      double top_y = i0->interp(i0->get_norm_t(wc), i1->get_norm_t(wc), i0->get_X(), i1->get_X(), xpos);
-      double bot_y = i0->interp(i0->get_norm_b(wc), i1->get_norm_b(wc), i0->get_X(), i1->get_X(), xpos);
-      top_y = top_y * choord;
-      bot_y = bot_y * choord;
+   // If we are in the trailing edge blend region, the adjust the top and bottom points
+   if (te_thck != 0.0) {
+      for (size_t i = 0; i < n; i++) {
+         if (wc[i] >= te_bl)
+            continue;
 
-      // If we are in the trailing edge blend region, the adjust the top and bottom points
-      if (te_thck != 0.0 && (wc < te_bl)) {
          // Find the top and bottom points of the airfoil at the trailing edge
-         double topte = i0->interp(i0->get_norm_t(0.0), i1->get_norm_t(0.0), i0->get_X(), i1->get_X(), xpos);
-         double botte = i0->interp(i0->get_norm_b(0.0), i1->get_norm_b(0.0), i0->get_X(), i1->get_X(), xpos); // Ha ha that spells botty
-         double cente = (topte + botte) / 2.0;                                                                // Centre of the TE
-         double haltk = te_thck / 2.0;                                                                        // Half the trailing edge thickness
-         double ostp = cente + haltk - topte;                                                                 // Top offset for blending
-         double osbt = cente - haltk - botte;                                                                 // Bottom offset for blending
+         double topte = Airfoil::interp(tte0[i], tte1[i], x0[i], x1[i], xpos[i]);
+         double botte = Airfoil::interp(bte0[i], bte1[i], x0[i], x1[i], xpos[i]); // Ha ha that spells botty
+         double cente = (topte + botte) / 2.0;                                   // Centre of the TE
+         double haltk = te_thck / 2.0;                                           // Half the trailing edge thickness
+         double ostp = cente + haltk - topte;                                    // Top offset for blending
+         double osbt = cente - haltk - botte;                                    // Bottom offset for blending
          sqvar topos(te_bl, 0.0, 0.0, ostp, squareness);
          sqvar botos(te_bl, 0.0, 0.0, osbt, squareness);
-         top_y += topos.vl(wc);
-         bot_y += botos.vl(wc);
+         top_y[i] += topos.vl(wc[i]);
+         bot_y[i] += botos.vl(wc[i]);
       }
-      // Add to the airfoil lines
-      topln.add(coord_t{ xpart, top_y });
-      botln.add(coord_t{ xpart, bot_y });
    }
 
-   topln.del_zero_lens();
-   botln.del_zero_lens();
-
-   // Combine into a drawing
-   obj airf;
-   airf.add(topln.get_sp(), botln.get_sp());
-   airf.add(topln.get_ep(), botln.get_ep());
-   airf.splice(topln);
-   airf.splice(botln);
-   airf.regularise();
-   return airf;
+   top.resize(n);
+   bot.resize(n);
+   for (size_t i = 0; i < n; i++) {
+      top[i] = coord_t{ xpart[i], top_y[i] };
+      bot[i] = coord_t{ xpart[i], bot_y[i] };
+   }
 }
 
 void Airfoil_set::findEnclosingAirfoils(double xpos, std::list<Airfoil_ref>::iterator& i0,
@@ -296,11 +561,11 @@ void Airfoil_set::te_blend(obj& ob, const sqvar& os, double blend_to_x) const {
       coord_t s1 = ln->get_S1();
 
       if (s0.x < blend_to_x) {
-         ln->set(coord_t{ s0.x, s0.y + os.vl(s0.x) }, s1);
+         ob.set(ln, coord_t{ s0.x, s0.y + os.vl(s0.x) }, s1);
          s0 = ln->get_S0();
       }
       if (s1.x < blend_to_x) {
-         ln->set(s0, coord_t{ s1.x, s1.y + os.vl(s1.x) });
+         ob.set(ln, s0, coord_t{ s1.x, s1.y + os.vl(s1.x) });
          s1 = ln->get_S1();
       }
    }
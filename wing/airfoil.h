@@ -17,6 +17,7 @@ You should have received a copy of the GNU General Public License
 along with this program.If not, see < https://www.gnu.org/licenses/>.
 */
 
+#include <map>
 #include <vector>
 
 #include "object_oo.h"
@@ -27,16 +28,40 @@ private:
    const double chord_os = 1e-6; //!<Oversize by this amount in order to prevent intersect misses at 0.0 and 1.0
    obj vec = {};                 //!<The normalised airfoil
 
+   //! The stretch of x between two neighbouring element ends of vec
+   struct span {
+      line ln[2];     //!<The first two elements of vec spanning it, in element order
+      size_t cnt = 0; //!<Number of elements spanning it
+   };
+   std::vector<double> sx;  //!<x of every element end of vec, in increasing order
+   std::vector<span> spans; //!<Between each sx and the next
+
+   //! Natural cubic spline of one surface against u = sqrt(le_x - x), which is smooth around the leading edge
+   struct surface {
+      std::vector<double> u; //!<Knots, increasing
+      std::vector<double> y; //!<Surface y at each knot
+      std::vector<double> m; //!<Second derivative of y by u at each knot
+
+      void fit();                 //!<Find m from u and y
+      double at(double uq) const; //!<y at uq, limited to the knots
+   };
+   bool smooth = false; //!<Look up from the surface splines rather than vec
+   double le_x = 0.0;   //!<x of the leading edge
+   surface upper;       //!<Top surface spline
+   surface lower;       //!<Bottom surface spline
+
+   bool fit_surfaces(); //!<Fit the splines to the points of vec, if each surface runs one way in x from the leading edge
+
 public:
-   explicit Airfoil(obj& dwg); //!<Parse dwg into an airfoil - choord line must be at y = 0
-
-   void get_norm_y(double c, double* ty, double* by);                      //!<Return normalised bottom y and top y
-   double get_norm_t(double c);                                            //!<Return normalised top line value
-   double get_norm_b(double c);                                            //!<Return normalised bot line value
-   double get_t(double xpos, double choord);                               //!<Return top line value for an x position along a choord length
-   double get_b(double xpos, double choord);                               //!<Return bot line value for an x position along a choord length
-   double interp(double v0, double v1, double r);                          //!<Between v0 and v1 by ratio r[0.0, 1.0]
-   double interp(double v0, double v1, double x0, double x1, double xpos); //!<Between (x0, v0) and (x1, v1) at xpos
+   explicit Airfoil(obj& dwg, bool spline = false); //!<Parse dwg into an airfoil - choord line must be at y = 0
+
+   void get_norm_y(double c, double* ty, double* by);                             //!<Return normalised bottom y and top y
+   double get_norm_t(double c);                                                   //!<Return normalised top line value
+   double get_norm_b(double c);                                                   //!<Return normalised bot line value
+   double get_t(double xpos, double choord);                                      //!<Return top line value for an x position along a choord length
+   double get_b(double xpos, double choord);                                      //!<Return bot line value for an x position along a choord length
+   static double interp(double v0, double v1, double r);                          //!<Between v0 and v1 by ratio r[0.0, 1.0]
+   static double interp(double v0, double v1, double x0, double x1, double xpos); //!<Between (x0, v0) and (x1, v1) at xpos
 };
 
 class Airfoil_ref : public Airfoil {
@@ -44,7 +69,7 @@ private:
    double xpos = 0.0; //!<x position of airfoil in planform
 
 public:
-   Airfoil_ref(obj& dwg, double xpos);
+   Airfoil_ref(obj& dwg, double xpos, bool spline = false);
    double get_X();
 };
 
@@ -59,17 +84,38 @@ private:
    const size_t draw_x_steps_draft = 75;          //!<As above but when running in draft mode
    size_t draw_x_steps = draw_x_steps_default;
    double draw_x_step = 1.0 / (double)(draw_x_steps - 1); //!<Size of each linear step assuming total range [0.0, 1.0]
+   const size_t draw_x_steps_min = 16;                    //!<Number of steps drawn before adding more where the airfoil curves
+   const double draw_err_draft = 0.1;                     //!<Draft mode distance from the airfoil allowed across an undrawn step
+   double draw_err = SIMPLIFY_ERR;                        //!<Distance from the airfoil allowed across an undrawn step
    mutable std::list<Airfoil_ref> airfoils = {};          //!<Our set of airfoil references
 
-   void te_blend(obj& ob, const sqvar& os, double blend_to_x) const; //!<Apply trailing edge blend
+   //! What generate_airfoil was asked for.  LE and TE are taken by identity, being the planform's own edges, so a
+   //! cached airfoil is only valid while those edges are unchanged and outlive this set; an edited edge, or another
+   //! obj later placed at the same address, would be answered with a stale airfoil.
+   struct gen_key {
+      double s0x, s0y, vdx, vdy, te_thck, te_bl;
+      size_t steps;
+      const obj *le, *te;
+      auto operator<=>(const gen_key&) const = default;
+   };
+   mutable std::map<gen_key, obj> generated; //!<Airfoils already generated, cleared when the airfoil set changes
+   mutable size_t genHits = 0;               //!<generate_airfoil calls answered from generated
+   mutable size_t genMisses = 0;             //!<generate_airfoil calls that had to build the airfoil
+
+   void te_blend(obj& ob, const sqvar& os, double blend_to_x) const;                       //!<Apply trailing edge blend
+   obj build_airfoil(line planLine, double te_thck, double te_bl, obj& LE, obj& TE) const; //!<Generate without the cache
+   void draw_stations(const std::vector<size_t>& at, line planLine, double te_thck, double te_bl, obj& LE, obj& TE,
+      std::vector<coord_t>& top, std::vector<coord_t>& bot) const; //!<Top and bottom points at the stations at, which increase
 
 public:
    Airfoil_set();
    void draft_mode(); //!<Change internals to draw ribs in a rough draft mode
    bool add(GenericTab* T, std::string& log);
-   bool add_from_dat_file(FILE** fp, double xpos, bool invert); //!<Import from a standard .dat representation
-   bool add_af_from_vectors(double xpos, const std::vector<double>& xs, const std::vector<double>& ys);
+   bool add_from_dat_file(FILE** fp, double xpos, bool invert, bool spline = false); //!<Import from a standard .dat representation
+   bool add_af_from_vectors(double xpos, const std::vector<double>& xs, const std::vector<double>& ys, bool spline = false);
    obj generate_airfoil(line planLine, double te_thck, double te_bl, obj& LE, obj& TE) const; //!<Generate the airfoil that matches the planform line
    void findEnclosingAirfoils(double x, std::list<Airfoil_ref>::iterator& i0,
       std::list<Airfoil_ref>::iterator& i1) const; //!< Find the two airfoils that x is between
+   size_t cache_hits() const { return genHits; }     //!<generate_airfoil calls answered from the cache
+   size_t cache_misses() const { return genMisses; } //!<generate_airfoil calls that built a new airfoil
 };
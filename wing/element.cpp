@@ -35,7 +35,7 @@ bool Element::create(Rib_set& rbs, std::string& log, bool draftmode) {
       // Find the element/rib intersection point
       coord_t planIs;
       if (yLn.lines_intersect(rb.objLn, &planIs, 0)) {
-         DBGLVL2("   Element intersects rib %d at %s", rb.index, planIs.prstr());
+         DBGLVL2("   Element intersects rib %d at %s", rb.index, coordStr(planIs).c_str());
 
          // Create a list of the roles that the element needs applying to, along with the Z types and a reference
          std::vector<obj*> applyToList;
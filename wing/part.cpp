@@ -253,7 +253,19 @@ bool Part::addHoles(std::string& log) {
    double leftlimit = p.find_extremity(LEFT);
    double rghtlimit = p.find_extremity(RIGHT);
 
-   for (double x = leftlimit; x < rghtlimit; x = x + H_STEP) {
+   // Find the outline at every step in a single sweep across the part
+   std::vector<double> xsteps;
+   std::vector<obj_vert_intersect> outline;
+   for (double x = leftlimit; x < rghtlimit; x = x + H_STEP)
+      xsteps.push_back(x);
+   r.top_bot_intersect(xsteps, outline);
+
+   for (size_t step = 0; step < xsteps.size(); step++) {
+      double x = xsteps[step];
+      upper = outline[step].upper;
+      lower = outline[step].lower;
+      upperln = outline[step].it_upper;
+      lowerln = outline[step].it_lower;
       if (!x_in_hole) {
          if (isInKeepout(x, lhbw)) { // Move on if x is in a keepout
             if (lastpr != 1) {
@@ -262,7 +274,7 @@ bool Part::addHoles(std::string& log) {
             }
             continue;
          }
-         if (!r.top_bot_intersect(x, &upper, &lower, upperln, lowerln)) { // Move on if no part outline at x
+         if (!outline[step].found) { // Move on if no part outline at x
             if (lastpr != 2) {
                DBGLVL2("%lf no rib outline", x);
                lastpr = 2;
@@ -296,7 +308,7 @@ bool Part::addHoles(std::string& log) {
       {
          if (isInKeepout(x, lhbw))
             DBGLVL2("%lf finishing hole - in keepout", x);
-         else if (!r.top_bot_intersect(x, &upper, &lower, upperln, lowerln))
+         else if (!outline[step].found)
             DBGLVL2("%lf finishing hole - no rib outline", x);
          else if (upperln->is_vertical() || lowerln->is_vertical())
             DBGLVL2("%lf finishing hole - outline has a vertical", x);
@@ -434,7 +446,7 @@ bool Part::cutSlot(
       return false;
    }
 
-   DBGLVL1("Reference point %s  Y at bottom of slot %.2lf", refPt.prstr(), yAtBottom);
+   DBGLVL1("Reference point %s  Y at bottom of slot %.2lf", coordStr(refPt).c_str(), yAtBottom);
 
    // Update the lean angle if snap-to-outline is selected
    if (sheetSlot && snapOutline) {
@@ -457,7 +469,7 @@ bool Part::cutSlot(
       slRef[i].ln.move_sideways((double)(1 - i) * (width / 2.0));
 
       // Find the intersects in the part outline and redraw the reference between them
-      std::list<obj_line_intersect> isects = {};
+      std::pmr::list<obj_line_intersect> isects = {};
       p.line_intersect(slRef[i].ln, &isects, 1);
 
       // Need at least one intersect to do anything
@@ -762,32 +774,7 @@ void Part::openGap(coord_t firstPt, line_iter firstLn, coord_t seconPt, line_ite
 }
 
 void Part::openGap(obj& p, coord_t firstPt, line_iter l0, coord_t seconPt, line_iter l1) {
-   // Delete any whole segments bridging the gap
-   if (l0 != l1) {
-      line_iter ln = p.nextc(l0);
-      while (ln != l1) {
-         line_iter nxt = p.nextc(ln);
-         p.del(ln);
-         ln = nxt;
-      }
-   }
-
-   // Create the partial segments to pt0 and from pt1
-   if (l0 == l1) {
-      // pt0 and pt1 are in the same segment
-      coord_t s1 = l0->get_S1();
-
-      // Shorten segment to reach only pt0
-      l0->set(l0->get_S0(), firstPt);
-
-      // Insert new segment from pt1
-      l1 = p.add(line(seconPt, s1));
-   }
-   else {
-      // Shorten to reach only their respective points
-      l0->set(l0->get_S0(), firstPt);
-      l1->set(seconPt, l1->get_S1());
-   }
+   p.make_gap(l0, firstPt, l1, seconPt);
 }
 
 void Part::trimByAutoKeepouts(double margin, int role) {
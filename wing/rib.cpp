@@ -90,7 +90,8 @@ void Rib::createRibPart(Planform& pl, Airfoil_set& af, bool draftMode, std::stri
    DBGLVL2("rjig and rorg drawn OK");
 
    if (w_sh_thck != 0.0) {
-      rorgo.trace_at_offset(-w_sh_thck);
+      if (!rorgo.trace_at_offset(-w_sh_thck, sh_trace))
+         log.append(SS("Rib ") + TS(index) + " could not be offset exactly, used the sampled sheeting trace\n");
       draftMode ? rorgo.simplify(0.1) : rorgo.simplify();
       DBGLVL2("Wing sheeting applied: %.2lf", w_sh_thck);
    }
@@ -338,6 +339,9 @@ bool Rib_set::addRibParams(GenericTab* T, std::string& log) {
       else if (T->gqst(r, "meta") == QString("TE Thickness")) {
          setTeThickness(r, T, log);
       }
+      else if (T->gqst(r, "meta") == QString("Exact Sheeting")) {
+         setSheetingTrace(r, T, log);
+      }
       else
          log.append(SS("Unknown type of rib param ") + T->gqst(r, "meta").toStdString() + "\n");
    }
@@ -451,6 +455,21 @@ bool Rib_set::setTeThickness(int r, GenericTab* T, std::string& log) {
    return true;
 }
 
+bool Rib_set::setSheetingTrace(int r, GenericTab* T, std::string& log) {
+   bool doesIntersect = false;
+   for (auto rib = begin(); rib != end(); ++rib) {
+      double xpos = (rib->refLn.get_S0().x + rib->refLn.get_S1().x) / 2.0;
+      if ((xpos >= T->gdbl(r, "STX")) && (xpos <= T->gdbl(r, "ENX"))) {
+         doesIntersect = true;
+         rib->sh_trace = TRACE_EXACT;
+      }
+   }
+   if (!doesIntersect)
+      log.append(SS("Exact sheeting row ") + TS(r + 1) + " does not affect any ribs\n");
+
+   return true;
+}
+
 bool Rib_set::create(Planform& pl, Airfoil_set& af, std::string& log) {
    for (auto rib = begin(); rib != end(); ++rib) {
       if (!rib->isCreated) {
@@ -495,8 +514,8 @@ bool Rib_set::addGeodetics(GenericTab* T, Planform& plnf, std::string& log) {
          coord_t r0bp, r0tp, r1bp, r1tp;
          if (!check_geodetic_intersect(rib0, &topln, &botln, &r0tp, &r0bp))
             continue; // Rib does not intersect top and bottom line
-         DBGLVL2("  Geodetic first reference rib index: %d at intersects: T%s  B%s", rib0->index, r0tp.prstr(),
-            r0bp.prstr());
+         DBGLVL2("  Geodetic first reference rib index: %d at intersects: T%s  B%s", rib0->index, coordStr(r0tp).c_str(),
+            coordStr(r0bp).c_str());
 
          // Have found a starting rib, find the next valid rib if there is one
          bool found_rib1 = false;
@@ -513,8 +532,8 @@ bool Rib_set::addGeodetics(GenericTab* T, Planform& plnf, std::string& log) {
          if (!found_rib1)
             continue; // No valid second rib
 
-         DBGLVL2("  Geodetic secon reference rib index: %d at intersects: T%s  B%s", rib1->index, r1tp.prstr(),
-            r1bp.prstr());
+         DBGLVL2("  Geodetic secon reference rib index: %d at intersects: T%s  B%s", rib1->index, coordStr(r1tp).c_str(),
+            coordStr(r1bp).c_str());
 
          // Can create a geodetic
          ribs.emplace_back();
@@ -49,6 +49,7 @@ public:
    double teW = 0.0;             //!< Width of TE in line of rib
    double rib_thck = 0.0;        //!< Material thickness of the rib
    double w_sh_thck = 0.0;       //!< Wing sheet thickness at the rib
+   trace_style_e sh_trace = TRACE_SAMPLED; //!< Offset engine used to remove the wing sheeting
    double te_thck = 0.0;         //!< Trailing edge thickness
    double jig_thck = 0.0;        //!< Thickness of sheeting jig material
    double te_blend = 0.0;        //!< Factor over which to blend TE thickness [0.0..1.0]
@@ -195,6 +196,11 @@ public:
     */
    bool setTeThickness(int r, GenericTab* T, std::string& log);
 
+   /**
+    * @brief Remove the wing sheeting from a range of ribs using the exact offset
+    */
+   bool setSheetingTrace(int r, GenericTab* T, std::string& log);
+
 private:
    bool check_geodetic_intersect(rib_iter rib, line* topln, line* botln, coord_t* top, coord_t* bot);
 
@@ -129,7 +129,7 @@ void Spar::ribSupport(Rib_set& ribs, std::string& log) {
          coord_t bot = { ist->posSpr - 100.0, -height };
          topObj.add(top);
          botObj.add(bot);
-         DBGLVL2("Adding Top Point: %s  Bot Point: %s", top.prstr(), bot.prstr());
+         DBGLVL2("Adding Top Point: %s  Bot Point: %s", coordStr(top).c_str(), coordStr(bot).c_str());
       }
 
       {
@@ -137,7 +137,7 @@ void Spar::ribSupport(Rib_set& ribs, std::string& log) {
          coord_t bot = { ist->posSpr, -height };
          topObj.add(top);
          botObj.add(bot);
-         DBGLVL2("Adding Top Point: %s  Bot Point: %s", top.prstr(), bot.prstr());
+         DBGLVL2("Adding Top Point: %s  Bot Point: %s", coordStr(top).c_str(), coordStr(bot).c_str());
       }
 
       if (ist == std::prev(iss.end())) {
@@ -146,7 +146,7 @@ void Spar::ribSupport(Rib_set& ribs, std::string& log) {
          coord_t bot = { ist->posSpr + 100.0, -height };
          topObj.add(top);
          botObj.add(bot);
-         DBGLVL2("Adding Top Point: %s  Bot Point: %s", top.prstr(), bot.prstr());
+         DBGLVL2("Adding Top Point: %s  Bot Point: %s", coordStr(top).c_str(), coordStr(bot).c_str());
       }
    }
 
@@ -293,7 +293,7 @@ bool Spar::drawSheetSparOutline(std::string& log) {
          coord_t bot = { ist->posSpr - height, ist->rib_bot.y };
          topObj.add(top);
          botObj.add(bot);
-         DBGLVL2("Adding Top Point: %s  Bot Point: %s", top.prstr(), bot.prstr());
+         DBGLVL2("Adding Top Point: %s  Bot Point: %s", coordStr(top).c_str(), coordStr(bot).c_str());
       }
 
       {
@@ -301,7 +301,7 @@ bool Spar::drawSheetSparOutline(std::string& log) {
          coord_t bot = { ist->posSpr, ist->rib_bot.y };
          topObj.add(top);
          botObj.add(bot);
-         DBGLVL2("Adding Top Point: %s  Bot Point: %s", top.prstr(), bot.prstr());
+         DBGLVL2("Adding Top Point: %s  Bot Point: %s", coordStr(top).c_str(), coordStr(bot).c_str());
       }
 
       if (ist == std::prev(iss.end())) {
@@ -311,7 +311,7 @@ bool Spar::drawSheetSparOutline(std::string& log) {
          coord_t bot = { ist->posSpr + height, ist->rib_bot.y };
          topObj.add(top);
          botObj.add(bot);
-         DBGLVL2("Adding Top Point: %s  Bot Point: %s", top.prstr(), bot.prstr());
+         DBGLVL2("Adding Top Point: %s  Bot Point: %s", coordStr(top).c_str(), coordStr(bot).c_str());
       }
    }
 
@@ -400,7 +400,7 @@ void Spar::sparRibIntersect(Rib_set& ribs, std::string& log) {
 
       // Find the spar/rib intersection point
       if (objLn.lines_intersect(rib->objLn, &is.intersect, 0)) {
-         DBGLVL1("Spar %d Rib %d : Intersect is at %s", index, rib->index, is.intersect.prstr());
+         DBGLVL1("Spar %d Rib %d : Intersect is at %s", index, rib->index, coordStr(is.intersect).c_str());
          is.rib = rib;
          is.posRib = rib->planToXpos(is.intersect);
          if (!rib->getPart().top_bot_intersect(is.posRib, &is.rib_top, &is.rib_bot)) {
@@ -408,7 +408,7 @@ void Spar::sparRibIntersect(Rib_set& ribs, std::string& log) {
                typeTxt + SS("Spar ") + TS(index) + " Rib " + TS(rib->index) + " Unable to find a top and bottom intersect to determine sheet spar depth at plan point" + TScoord(is.intersect) + "\n");
             continue;
          }
-         DBGLVL2("X position on rib %.2lf  Rib Top %s  Rib Bottom %s", is.posRib, is.rib_top.prstr(), is.rib_bot.prstr());
+         DBGLVL2("X position on rib %.2lf  Rib Top %s  Rib Bottom %s", is.posRib, coordStr(is.rib_top).c_str(), coordStr(is.rib_bot).c_str());
 
          // Find the slot widths
          if (widenSlots) {
@@ -439,7 +439,7 @@ void Spar::sparRibIntersect(Rib_set& ribs, std::string& log) {
                }
                DBGLVL2("X position on rib %.2lf  Rib Top %s  Rib Bottom %s  recalculated from raw part due to keepout",
                   is.posRib,
-                  is.rib_top.prstr(), is.rib_bot.prstr());
+                  coordStr(is.rib_top).c_str(), coordStr(is.rib_bot).c_str());
             }
          }
 
@@ -73,6 +73,9 @@ public:
    LeTemplate_set lets;
 
 private:
+   //! Working memory for the geometry operations while this wing is built and exported.  Installing it replaces the
+   //! process-wide std::pmr default resource for as long as the Wing exists.
+   geom_arena arena;
 };
 
 void loadWingFiles(FILE** wfp);